@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <chrono>
+#include "../vowpalwabbit/parser.h"
+#include "../vowpalwabbit/vw.h"
+#include "../vowpalwabbit/learner.h"
+
+using namespace std;
+
+// Compares how fast --noop reads back a cache written as a plain stream, as
+// gzip (--compressed), as uncompressed blocks and as LZ compressed blocks.
+
+size_t run(const string& args, double& seconds)
+{ vw* all = VW::initialize(args);
+  auto start = chrono::high_resolution_clock::now();
+  VW::start_parser(*all);
+  LEARNER::generic_driver(*all);
+  VW::end_parser(*all);
+  auto stop = chrono::high_resolution_clock::now();
+  size_t examples = all->p->end_parsed_examples;
+  VW::finish(*all);
+  seconds = chrono::duration<double>(stop - start).count();
+  return examples;
+}
+
+void bench(const char* name, const string& data, const string& write_opts, const string& read_opts, size_t passes)
+{ string cache = "cache_bench.cache";
+  remove(cache.c_str());
+  double seconds;
+  run("--quiet --noop -k -d " + data + " --cache_file " + cache + " " + write_opts, seconds);
+  struct stat st;
+  stat(cache.c_str(), &st);
+
+  size_t examples = run("--quiet --noop --holdout_off --cache_file " + cache + " --passes " + to_string(passes) + " " + read_opts, seconds);
+  remove(cache.c_str());
+  printf("%-18s %10lld bytes %10.0f examples/s %8.1f MB/s\n", name, (long long)st.st_size,
+         examples / seconds, st.st_size * (double)passes / seconds / 1e6);
+}
+
+int main(int argc, char *argv[])
+{ string data = argc > 1 ? argv[1] : "../test/train-sets/rcv1_small.dat";
+  size_t passes = argc > 2 ? atol(argv[2]) : 20;
+
+  cout << "data = " << data << ", passes = " << passes << endl;
+  bench("stream", data, "", "", passes);
+  bench("zlib", data, "--compressed", "--compressed", passes);
+  bench("blocks", data, "--block_cache", "", passes);
+  bench("lz blocks", data, "--compress_blocks", "", passes);
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../vowpalwabbit/vw.h"
+#include "../vowpalwabbit/rand48.h"
+#include "../vowpalwabbit/dense_kernels.h"
+
+using namespace std;
+
+// Learns from examples with one dense namespace of numeric feature names 0..dims-1
+// (an embedding) and one sparse namespace, with the dense namespace handed to the
+// strided kernels and with it read a feature at a time, and reports examples/s for
+// each along with the largest difference in their predictions.
+//   dense_bench [examples] [dims ...]
+
+typedef chrono::high_resolution_clock bench_clock;
+
+// labeled by the sign of a fixed linear function of the dense features
+string example_text(size_t dims, uint64_t& seed)
+{ string text;
+  float margin = 0.f;
+  char feature[64];
+  for (size_t i = 0; i < dims; i++)
+  { float x = (merand48(seed) < 0.5 ? -1.f : 1.f) * (0.05f + merand48(seed));
+    margin += (i % 3 == 0 ? 1.f : -0.5f) * x;
+    sprintf(feature, " %zu:%.4f", i, x);
+    text += feature;
+  }
+  sprintf(feature, " |s %u", (unsigned)(1e6 * merand48(seed)));
+  return (margin > 0.f ? "1 |e" : "-1 |e") + text + feature;
+}
+
+// the predictions made while learning, and the seconds it took
+double learn(const string& options, size_t examples, size_t dims, bool dense, vector<float>& predictions)
+{ vw* all = VW::initialize(options + " --ring_size " + to_string(examples));
+  uint64_t seed = 1;
+  vector<example*> ecs;
+  for (size_t e = 0; e < examples; e++)
+  { string text = example_text(dims, seed);
+    ecs.push_back(VW::read_example(*all, text.c_str()));
+    if (!dense)
+      for (features& fs : *ecs.back())
+        fs.dense_step = 0;
+  }
+
+  predictions.clear();
+  auto start = bench_clock::now();
+  for (size_t pass = 0; pass < 5; pass++)
+    for (example* ec : ecs)
+    { all->learn(*ec);
+      predictions.push_back(ec->pred.scalar);
+    }
+  double seconds = chrono::duration<double>(bench_clock::now() - start).count();
+  for (example* ec : ecs)
+    VW::finish_example(*all, *ec);
+  VW::finish(*all);
+  return seconds;
+}
+
+int main(int argc, char *argv[])
+{ size_t examples = argc > 1 ? atol(argv[1]) : 20000;
+  vector<size_t> dims;
+  for (int i = 2; i < argc; i++)
+    dims.push_back(atol(argv[i]));
+  if (dims.empty())
+    dims = { 16, 64, 256 };
+
+  printf("kernels: %s\n", dense_kernel_isa());
+  for (size_t d : dims)
+    for (const char* learner : { "--sgd -l 0.01", "--adaptive -l 0.1", "--normalized", "" })
+    { string options = string("--quiet -b 20 --loss_function logistic ") + learner;
+      vector<float> dense_predictions, sparse_predictions;
+      double dense = learn(options, examples, d, true, dense_predictions);
+      double sparse = learn(options, examples, d, false, sparse_predictions);
+      float difference = 0.f;
+      for (size_t i = 0; i < dense_predictions.size(); i++)
+        difference = fmaxf(difference, fabsf(dense_predictions[i] - sparse_predictions[i]));
+      printf("dims %-4zu %-18s a feature at a time %9.0f examples/s  dense %9.0f examples/s  max difference %g\n",
+             d, learner[0] ? learner : "(default)", 5 * examples / sparse, 5 * examples / dense, difference);
+    }
+  return 0;
+}
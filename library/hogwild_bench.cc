@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include "../vowpalwabbit/parser.h"
+#include "../vowpalwabbit/vw.h"
+#include "../vowpalwabbit/learner.h"
+
+using namespace std;
+
+// Trains on a cache with --threads 1, 2, 4, 8 and 16, reporting throughput
+// and the average training loss, which hogwild updates may shift a little.
+
+struct result
+{ size_t examples;
+  double seconds;
+  double loss;
+};
+
+result run(const string& args)
+{ vw* all = VW::initialize(args);
+  auto start = chrono::high_resolution_clock::now();
+  VW::start_parser(*all);
+  LEARNER::generic_driver(*all);
+  VW::end_parser(*all);
+  auto stop = chrono::high_resolution_clock::now();
+  result r = { (size_t)all->sd->example_number, chrono::duration<double>(stop - start).count(),
+               all->sd->sum_loss / all->sd->weighted_labeled_examples };
+  VW::finish(*all);
+  return r;
+}
+
+int main(int argc, char *argv[])
+{ string data = argc > 1 ? argv[1] : "../test/train-sets/rcv1_small.dat";
+  size_t passes = argc > 2 ? atol(argv[2]) : 20;
+  string cache = "hogwild_bench.cache";
+
+  cout << "data = " << data << ", passes = " << passes << ", cores = " << thread::hardware_concurrency() << endl;
+  remove(cache.c_str());
+  run("--quiet --noop -k -d " + data + " --cache_file " + cache);
+
+  double base = 0;
+  for (size_t threads = 1; threads <= 16; threads *= 2)
+  { result r = run("--quiet --holdout_off --cache_file " + cache + " --passes " + to_string(passes) + " --threads " + to_string(threads));
+    double rate = r.examples / r.seconds;
+    if (threads == 1)
+      base = rate;
+    printf("%2d threads %10.0f examples/s %5.2fx  loss %.6f\n", (int)threads, rate, rate / base, r.loss);
+  }
+  remove(cache.c_str());
+  return 0;
+}
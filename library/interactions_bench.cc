@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../vowpalwabbit/vw.h"
+#include "../vowpalwabbit/learner.h"
+#include "../vowpalwabbit/rand48.h"
+
+using namespace std;
+
+// Learns from a synthetic data set of four namespaces with pairs (-q), triples
+// (--cubic) and 4-way --interactions of them, and reports examples/s and
+// generated features/s for each, with the given options added to every run
+// (e.g. --interaction_cache).
+//   interactions_bench [examples] [features per namespace] [options]
+
+typedef chrono::high_resolution_clock bench_clock;
+
+void write_data(const string& file, size_t examples, size_t per_namespace)
+{ ofstream out(file);
+  uint64_t seed = 1;
+  for (size_t e = 0; e < examples; e++)
+  { out << (merand48(seed) < 0.5 ? "-1" : "1");
+    for (const char* ns : { "a", "b", "c", "d" })
+    { out << " |" << ns;
+      for (size_t i = 0; i < per_namespace; i++)
+        out << " " << (uint64_t)(1e7 * merand48(seed)) << ":" << merand48(seed);
+    }
+    out << "\n";
+  }
+}
+
+void train(const string& data, const string& interactions, size_t examples)
+{ vw* all = VW::initialize("--quiet --holdout_off -b 22 -d " + data + " " + interactions);
+  clock_t cpu = clock();
+  auto start = bench_clock::now();
+  VW::start_parser(*all);
+  LEARNER::generic_driver(*all);
+  VW::end_parser(*all);
+  double seconds = chrono::duration<double>(bench_clock::now() - start).count();
+  double cpu_seconds = (double)(clock() - cpu) / CLOCKS_PER_SEC;
+  double features = all->sd->total_features;
+  VW::finish(*all);
+
+  printf("%-44s %9.0f examples/s %7.1f M features/s %7.3f cpu s\n", interactions.c_str(), examples / seconds, features / seconds / 1e6, cpu_seconds);
+}
+
+int main(int argc, char *argv[])
+{ size_t examples = argc > 1 ? atol(argv[1]) : 20000;
+  size_t per_namespace = argc > 2 ? atol(argv[2]) : 6;
+  string options = argc > 3 ? string(" ") + argv[3] : "";
+
+  string data = "interactions_bench.dat";
+  write_data(data, examples, per_namespace);
+  for (const char* interactions : { "-q ab", "-q ab -q cd", "-q aa", "--cubic abc", "--cubic aab", "--interactions abcd",
+                                    "--interactions aabb", "--interactions abcdd", "--interactions abcd --interactions abc -q ab" })
+    train(data, interactions + options, examples);
+  remove(data.c_str());
+  return 0;
+}
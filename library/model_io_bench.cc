@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../vowpalwabbit/vw.h"
+#include "../vowpalwabbit/rand48.h"
+
+using namespace std;
+
+// Saves and loads models whose weights are nonzero at a given density, with
+// the weight chunks coded by one thread and by one per core, and reports the
+// seconds each takes.
+//   model_io_bench [density] [-b ...]
+
+typedef chrono::high_resolution_clock bench_clock;
+
+void bench(const string& bits, float density, size_t threads)
+{ string file = "model_io_bench.model";
+  string options = "--quiet -b " + bits + " --model_threads " + to_string(threads);
+  vw* all = VW::initialize(options);
+  uint64_t seed = 1;
+  uint64_t length = (uint64_t)1 << all->num_bits;
+  for (uint64_t i = 0; i < length; i++)
+    if (merand48(seed) < density)
+      all->weights.dense_weights.strided_index(i) = merand48(seed) - 0.5f;
+
+  auto start = bench_clock::now();
+  VW::save_predictor(*all, file);
+  double save = chrono::duration<double>(bench_clock::now() - start).count();
+  VW::finish(*all);
+
+  start = bench_clock::now();
+  all = VW::initialize("--quiet --model_threads " + to_string(threads) + " -t -i " + file);
+  double load = chrono::duration<double>(bench_clock::now() - start).count();
+  VW::finish(*all);
+
+  FILE* f = fopen(file.c_str(), "rb");
+  fseek(f, 0, SEEK_END);
+  double mb = ftell(f) / 1048576.;
+  fclose(f);
+  remove(file.c_str());
+  printf("-b %-3s density %-6g threads %-3zu %8.1f MB  save %7.3f s  load %7.3f s\n", bits.c_str(), density, threads, mb, save, load);
+}
+
+int main(int argc, char *argv[])
+{ float density = argc > 1 ? (float)atof(argv[1]) : 0.1f;
+  vector<string> bits;
+  for (int i = 2; i < argc; i++)
+    bits.push_back(argv[i]);
+  if (bits.empty())
+    bits = { "20", "24", "26" };
+
+  size_t cores = max(1u, thread::hardware_concurrency());
+  for (string& b : bits)
+  { bench(b, density, 1);
+    if (cores > 1)
+      bench(b, density, cores);
+  }
+  return 0;
+}
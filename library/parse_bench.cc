@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../vowpalwabbit/vw.h"
+#include "../vowpalwabbit/delimiter_scan.h"
+
+using namespace std;
+
+// Measures how fast text examples are parsed, with no learning: first the
+// delimiter scan alone, one byte at a time and vectorized, then whole
+// examples through VW::read_example.
+
+typedef chrono::high_resolution_clock bench_clock;
+
+double mb_per_s(size_t bytes, bench_clock::time_point start)
+{ return bytes / chrono::duration<double>(bench_clock::now() - start).count() / 1e6;
+}
+
+int main(int argc, char *argv[])
+{ if (argc < 2)
+  { cerr << "usage: " << argv[0] << " <text examples> [repeats] [vw arguments]" << endl;
+    return 1;
+  }
+  size_t repeats = argc > 2 ? atol(argv[2]) : 10;
+  string args = string("--quiet --noop --no_stdin ") + (argc > 3 ? argv[3] : "");
+
+  vector<string> lines;
+  size_t bytes = 0;
+  ifstream in(argv[1]);
+  for (string line; getline(in, line);)
+  { bytes += line.size() + 1;
+    lines.push_back(line);
+  }
+  bytes *= repeats;
+  cout << "lines = " << lines.size() << ", repeats = " << repeats << ", delimiter scan = " << delimiter_scan_isa() << endl;
+
+  vector<uint64_t> mask;
+  uint64_t checksum = 0;
+  for (int vectorized = 0; vectorized < 2; vectorized++)
+  { auto start = bench_clock::now();
+    for (size_t r = 0; r < repeats; r++)
+      for (string& line : lines)
+      { mask.resize(delimiter_words(line.size()) + 1);
+        if (vectorized)
+          find_delimiters(line.data(), line.size(), mask.data());
+        else
+          find_delimiters_scalar(line.data(), line.size(), mask.data());
+        checksum += mask[0];
+      }
+    cout << (vectorized ? "vectorized scan: " : "scalar scan:     ") << mb_per_s(bytes, start) << " MB/s" << endl;
+  }
+
+  vw* all = VW::initialize(args);
+  vector<char> buffer;
+  auto start = bench_clock::now();
+  for (size_t r = 0; r < repeats; r++)
+    for (string& line : lines)
+    { // read_example parses in place
+      buffer.assign(line.begin(), line.end());
+      buffer.push_back('\0');
+      example* ec = VW::read_example(*all, buffer.data());
+      checksum += ec->num_features;
+      VW::finish_example(*all, *ec);
+    }
+  cout << "parse examples:  " << mb_per_s(bytes, start) << " MB/s" << endl;
+  VW::finish(*all);
+
+  return checksum == 0;
+}
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../vowpalwabbit/vw.h"
+#include "../vowpalwabbit/rand48.h"
+
+using namespace std;
+
+// Trains a model on a synthetic data set of three namespaces, loads it into a
+// vw that only predicts (-t) and reports the nanoseconds a prediction takes on
+// examples parsed beforehand, so that the time is the learner stack's alone.
+// With few bits the weights stay in cache and it is the stack's own overhead.
+//   predict_bench [examples] [features per namespace] [bits] [options of the predicting vw]
+
+typedef chrono::high_resolution_clock bench_clock;
+
+string example_text(size_t per_namespace, uint64_t& seed)
+{ string text = merand48(seed) < 0.5 ? "-1" : "1";
+  char feature[64];
+  for (const char* ns : { "a", "b", "c" })
+  { text += string(" |") + ns;
+    for (size_t i = 0; i < per_namespace; i++)
+    { sprintf(feature, " %u:%.3f", (unsigned)(1e6 * merand48(seed)), merand48(seed));
+      text += feature;
+    }
+  }
+  return text;
+}
+
+double predict(const string& train_options, const string& predict_options, size_t examples, size_t per_namespace, size_t bits)
+{ string model = "predict_bench.model";
+  vw* trainer = VW::initialize("--quiet -b " + to_string(bits) + " -f " + model + " " + train_options + " --ring_size " + to_string(examples));
+  uint64_t seed = 1;
+  for (size_t e = 0; e < examples; e++)
+  { string text = example_text(per_namespace, seed);
+    example* ec = VW::read_example(*trainer, text.c_str());
+    trainer->learn(*ec);
+    VW::finish_example(*trainer, *ec);
+  }
+  VW::finish(*trainer);
+
+  vw* all = VW::initialize("--quiet -t -i " + model + " " + predict_options + " --ring_size " + to_string(examples));
+  seed = 1;
+  vector<example*> ecs;
+  for (size_t e = 0; e < examples; e++)
+  { string text = example_text(per_namespace, seed);
+    ecs.push_back(VW::read_example(*all, text.c_str()));
+  }
+  const size_t passes = 20;
+  float sum = 0.f;
+  auto start = bench_clock::now();
+  for (size_t pass = 0; pass < passes; pass++)
+    for (example* ec : ecs)
+    { all->predict(*ec);
+      sum += ec->pred.scalar;
+    }
+  double seconds = chrono::duration<double>(bench_clock::now() - start).count();
+  for (example* ec : ecs)
+    VW::finish_example(*all, *ec);
+  VW::finish(*all);
+  remove(model.c_str());
+  if (sum != sum)
+    printf("nan prediction\n");
+  return seconds * 1e9 / (passes * examples);
+}
+
+int main(int argc, char *argv[])
+{ size_t examples = argc > 1 ? atol(argv[1]) : 10000;
+  size_t per_namespace = argc > 2 ? atol(argv[2]) : 8;
+  size_t bits = argc > 3 ? atol(argv[3]) : 20;
+  string predict_options = argc > 4 ? argv[4] : "";
+
+  for (const char* interactions : { "", "-q ab", "-q ab -q ac -q bc", "--cubic abc", "-q ab --link logistic --loss_function logistic" })
+    printf("%-48s %8.1f ns/prediction\n", interactions[0] ? interactions : "(linear)",
+           predict(interactions, predict_options, examples, per_namespace, bits));
+  return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "../vowpalwabbit/parser.h"
+#include "../vowpalwabbit/vw.h"
+#include "../vowpalwabbit/learner.h"
+#include "../vowpalwabbit/rand48.h"
+
+using namespace std;
+
+// Trains on a synthetic two namespace data set with -q ab at several -b and
+// --prefetch_distance settings and reports examples/s and, where the kernel
+// lets us count them, last level cache misses per example.
+//   prefetch_bench [examples] [features per namespace] [-b ...]
+
+typedef chrono::high_resolution_clock bench_clock;
+
+struct cache_misses
+{ int fd;
+
+  cache_misses() : fd(-1)
+  {
+#ifdef __linux__
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+
+  ~cache_misses()
+  { if (fd >= 0)
+      close(fd);
+  }
+
+  void start()
+  {
+#ifdef __linux__
+    if (fd >= 0)
+    { ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  // -1 when the counter is not available, e.g. in a VM or with perf_event_paranoid > 2
+  long long stop()
+  { long long count = -1;
+#ifdef __linux__
+    if (fd >= 0)
+    { ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd, &count, sizeof(count)) != sizeof(count))
+        count = -1;
+    }
+#endif
+    return count;
+  }
+};
+
+void write_data(const string& file, size_t examples, size_t per_namespace)
+{ ofstream out(file);
+  uint64_t seed = 1;
+  for (size_t e = 0; e < examples; e++)
+  { out << (merand48(seed) < 0.5 ? "-1" : "1");
+    for (const char* ns : { "a", "b" })
+    { out << " |" << ns;
+      for (size_t i = 0; i < per_namespace; i++)
+        out << " " << (uint64_t)(1e7 * merand48(seed)) << ":" << merand48(seed);
+    }
+    out << "\n";
+  }
+}
+
+void train(const string& args, size_t examples, cache_misses& misses)
+{ vw* all = VW::initialize(args);
+  misses.start();
+  auto start = bench_clock::now();
+  VW::start_parser(*all);
+  LEARNER::generic_driver(*all);
+  VW::end_parser(*all);
+  double seconds = chrono::duration<double>(bench_clock::now() - start).count();
+  long long count = misses.stop();
+  VW::finish(*all);
+
+  printf("%-50s %9.0f examples/s", args.c_str() + args.find("-b"), examples / seconds);
+  if (count >= 0)
+    printf(" %8.1f misses/example", (double)count / examples);
+  printf("\n");
+}
+
+int main(int argc, char *argv[])
+{ size_t examples = argc > 1 ? atol(argv[1]) : 20000;
+  size_t per_namespace = argc > 2 ? atol(argv[2]) : 40;
+  vector<string> bits;
+  for (int i = 3; i < argc; i++)
+    bits.push_back(argv[i]);
+  if (bits.empty())
+    bits = { "18", "24", "26" };
+
+  string data = "prefetch_bench.dat";
+  write_data(data, examples, per_namespace);
+
+  cache_misses misses;
+  if (misses.fd < 0)
+    printf("cache miss counter not available\n");
+  for (string& b : bits)
+    for (const char* distance : { "0", "4", "8", "16" })
+      train("--quiet --holdout_off -d " + data + " -q ab -b " + b + " --prefetch_distance " + distance, examples, misses);
+  remove(data.c_str());
+  return 0;
+}
@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include "../vowpalwabbit/parser.h"
+#include "../vowpalwabbit/vw.h"
+
+using namespace std;
+
+// Measures the cost of handing empty examples from a producer thread to a
+// consumer thread through the example ring, with and without --lockfree_ring.
+
+double handoff_ns(const string& args, size_t count)
+{ vw* all = VW::initialize(args);
+
+  thread producer([all, count]()
+  { for (size_t i = 0; i < count; i++)
+    { example* ec = &VW::get_unused_example(all);
+      publish_examples(*all, &ec, 1);
+    }
+    lock_done(*all->p);
+  });
+
+  auto start = chrono::high_resolution_clock::now();
+  size_t received = 0;
+  example* ec;
+  while ((ec = VW::get_example(all->p)) != nullptr)
+  { VW::finish_example(*all, *ec);
+    received++;
+  }
+  auto stop = chrono::high_resolution_clock::now();
+  producer.join();
+
+  if (received != count)
+    cerr << "lost examples: " << received << " of " << count << endl;
+  VW::finish(*all);
+  return chrono::duration<double, nano>(stop - start).count() / count;
+}
+
+int main(int argc, char *argv[])
+{ size_t count = argc > 1 ? atol(argv[1]) : 10000000;
+  string ring = argc > 2 ? string(" --ring_size ") + argv[2] : string();
+  string args = "--quiet --no_stdin" + ring;
+
+  cout << "examples = " << count << endl;
+  cout << "locked ring:    " << handoff_ns(args, count) << " ns/example" << endl;
+  cout << "lock-free ring: " << handoff_ns(args + " --lockfree_ring", count) << " ns/example" << endl;
+  return 0;
+}
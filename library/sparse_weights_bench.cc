@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+#include "../vowpalwabbit/parser.h"
+#include "../vowpalwabbit/vw.h"
+#include "../vowpalwabbit/learner.h"
+#include "../vowpalwabbit/rand48.h"
+
+using namespace std;
+
+// Compares sparse_parameters with the unordered_map of separately allocated
+// weight blocks it used to be, first on a synthetic stream of feature and
+// quadratic indices, then end to end on --sparse_weights -b 32 training.
+// The map allocates a page per weight block, so keep the stream short.
+
+typedef chrono::high_resolution_clock bench_clock;
+
+double seconds_since(bench_clock::time_point start)
+{ return chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+struct map_weights // the previous sparse_parameters lookup
+{ unordered_map<uint64_t, weight*> map;
+  uint64_t mask;
+  uint32_t stride;
+
+  weight& operator[](uint64_t i)
+  { uint64_t index = i & mask;
+    auto iter = map.find(index);
+    if (iter == map.end())
+      iter = map.insert(make_pair(index, calloc_mergable_or_throw<weight>(stride))).first;
+    return *iter->second;
+  }
+
+  ~map_weights()
+  { for (auto& p : map)
+      free(p.second);
+  }
+};
+
+template<class W> double stream(W& weights, const vector<uint64_t>& features, size_t per_example, uint32_t stride_shift)
+{ auto start = bench_clock::now();
+  for (size_t e = 0; e + per_example <= features.size(); e += per_example)
+    for (size_t i = e; i < e + per_example; i++)
+    { weights[features[i] << stride_shift] += 1.f;
+      for (size_t j = i + 1; j < e + per_example; j++)
+        weights[(features[i] * 0x2f0f3726ULL ^ features[j]) << stride_shift] += 1.f;
+    }
+  return seconds_since(start);
+}
+
+double train(const string& args)
+{ vw* all = VW::initialize(args);
+  auto start = bench_clock::now();
+  VW::start_parser(*all);
+  LEARNER::generic_driver(*all);
+  VW::end_parser(*all);
+  double seconds = seconds_since(start);
+  VW::finish(*all);
+  return seconds;
+}
+
+int main(int argc, char *argv[])
+{ string data = argc > 1 ? argv[1] : "../test/train-sets/rcv1_small.dat";
+  size_t examples = argc > 2 ? atol(argv[2]) : 2000;
+  const size_t per_example = 30;
+  const uint32_t stride_shift = 2; // adaptive and normalized gd
+  const uint64_t mask = (((uint64_t)1 << 32) << stride_shift) - 1;
+
+  // a few common features and a long tail, like text
+  uint64_t seed = 1;
+  vector<uint64_t> features;
+  for (size_t i = 0; i < examples * per_example; i++)
+  { float r = merand48(seed);
+    features.push_back((uint64_t)(1e6 * r * r * r * r) * 0x9E3779B1ULL);
+  }
+
+  map_weights m;
+  m.mask = mask;
+  m.stride = 1 << stride_shift;
+  double map_seconds = stream(m, features, per_example, stride_shift);
+
+  sparse_parameters s((uint64_t)1 << 32, stride_shift);
+  double table_seconds = stream(s, features, per_example, stride_shift);
+
+  double lookups = examples * (per_example + per_example * (per_example - 1) / 2.);
+  printf("%zu weights touched\n", m.map.size());
+  printf("unordered_map   %8.1f M lookups/s\n", lookups / map_seconds / 1e6);
+  printf("open addressing %8.1f M lookups/s\n", lookups / table_seconds / 1e6);
+
+  string args = "--quiet --holdout_off --sparse_weights -b 32 -d " + data;
+  printf("train --sparse_weights -b 32        %6.3f s\n", train(args));
+  printf("train --sparse_weights -b 32 -q ff  %6.3f s\n", train(args + " -q ff"));
+  return 0;
+}
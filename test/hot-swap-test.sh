@@ -0,0 +1,120 @@
+#!/bin/bash
+# -- vw --hot_swap test: a daemon reloads its -i model on SIGHUP, and keeps
+#    the current one when the new model was trained with other options
+#
+NAME='vw-hot-swap-test'
+
+export PATH="vowpalwabbit:../vowpalwabbit:${PATH}"
+# The VW under test
+VW=`which vw`
+
+MODEL=$NAME.model
+TRAINSET=$NAME.train
+PREDREF=$NAME.predref
+PREDOUT=$NAME.predict
+DAEMON_STDERR=$NAME.stderr
+NETCAT_STATUS=$NAME.netcat-status
+PORT=54249
+
+# -- make sure we can find vw first
+if [ -x "$VW" ]; then
+    : cool found vw at: $VW
+else
+    echo "$NAME: can not find 'vw' in $PATH - sorry"
+    exit 1
+fi
+
+# -- and netcat
+NETCAT=`which netcat`
+if [ -x "$NETCAT" ]; then
+    : cool found netcat at: $NETCAT
+else
+    NETCAT=`which nc`
+    if [ -x "$NETCAT" ]; then
+        : "no netcat but found 'nc' at: $NETCAT"
+    else
+        echo "$NAME: can not find 'netcat' not 'nc' in $PATH - sorry"
+        exit 1
+    fi
+fi
+
+DaemonCmd="$VW -t -i $MODEL --daemon --foreground --num_children 1 --hot_swap --port $PORT"
+# libtool may wrap vw with '.libs/lt-vw' so we need to be flexible
+# on the exact process pattern we try to kill.
+DaemonPat=`echo $DaemonCmd | sed 's/^[^ ]*vw /.*vw /'`
+
+cleanup() {
+    /bin/rm -f $MODEL $TRAINSET $PREDREF $PREDOUT $DAEMON_STDERR $NETCAT_STATUS
+    # the children too, which would go on answering on the port
+    pkill -9 -f "$DaemonPat"
+}
+
+fail() {
+    echo "$NAME FAILED: $1"
+    cleanup
+    exit 1
+}
+
+# the predictions of the daemon on the training set
+daemon_predict() {
+    /bin/rm -f $PREDOUT $NETCAT_STATUS
+    touch $PREDOUT
+    ( $NETCAT localhost $PORT < $TRAINSET > $PREDOUT; STATUS=$?; echo $STATUS > $NETCAT_STATUS ) &
+    NetcatPid=$!
+    until [ `wc -l < $PREDOUT` -eq 2 ]; do
+        if [ -f $NETCAT_STATUS ] && [ `cat $NETCAT_STATUS` -ne 0 ]; then
+            fail "netcat failed with status code `cat $NETCAT_STATUS`"
+        fi
+    done
+    kill -9 $NetcatPid 2>/dev/null
+    wait $NetcatPid 2>/dev/null
+}
+
+# sends SIGHUP and waits for the daemon to report the reload with $1
+reload() {
+    kill -HUP $DaemonPid
+    for i in `seq 100`; do
+        if grep -q "$1" $DAEMON_STDERR; then
+            return
+        fi
+        sleep 0.1
+    done
+    fail "the daemon did not report '$1' after SIGHUP"
+}
+
+# -- main
+cleanup
+
+cat > $TRAINSET <<EOF
+0.55 1 '1|a a1 |b b1
+0.99 1 '2|a a2 |b b1 b2
+EOF
+
+$VW -b 10 --quiet -d $TRAINSET -f $MODEL
+$VW -t -i $MODEL -d $TRAINSET -p $PREDREF.first --quiet
+
+# started from a subshell, so that this shell reports nothing when it is killed
+DaemonPid=`$DaemonCmd </dev/null >/dev/null 2>$DAEMON_STDERR & echo $!`
+sleep 0.5
+
+daemon_predict
+diff <(cut -c-5 $PREDREF.first) <(cut -c-5 $PREDOUT) > /dev/null || fail "first model: see $PREDREF.first vs $PREDOUT"
+
+# a model with interactions the daemon was not set up with is refused
+$VW -b 10 --quiet -d $TRAINSET -q ab --passes 2 -c -k --holdout_off -f $MODEL
+reload "keeping the current model"
+daemon_predict
+diff <(cut -c-5 $PREDREF.first) <(cut -c-5 $PREDOUT) > /dev/null || fail "model with -q ab was swapped in: see $PREDREF.first vs $PREDOUT"
+
+# a model trained the same way is swapped in
+$VW -b 10 --quiet -d $TRAINSET --passes 3 -c -k --holdout_off -f $MODEL
+$VW -t -i $MODEL -d $TRAINSET -p $PREDREF --quiet
+reload "swapped in"
+daemon_predict
+diff <(cut -c-5 $PREDREF) <(cut -c-5 $PREDOUT) > /dev/null || fail "second model: see $PREDREF vs $PREDOUT"
+diff -q $PREDREF $PREDREF.first > /dev/null && fail "the second model predicts as the first"
+
+echo "$NAME: OK"
+/bin/rm -f $PREDREF.first $TRAINSET.cache
+cleanup
+exit 0
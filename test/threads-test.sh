@@ -0,0 +1,90 @@
+#!/bin/bash
+# -- vw --threads test: hogwild learners against one thread
+#    train:   learning from the cache of one thread ends with about its loss
+#    predict: -t gives the predictions and loss of one thread, in any order
+#    refuse:  a combination --threads can't run is refused before learning
+#
+NAME='vw-threads-test'
+
+export PATH="vowpalwabbit:../vowpalwabbit:${PATH}"
+# The VW under test
+VW=`which vw`
+
+TRAINSET=train-sets/0001.dat
+CACHE=$NAME.cache
+MODEL=$NAME.model
+STDERR=$NAME.stderr
+# learning order differs from run to run, so losses agree only this closely
+TOLERANCE=0.01
+
+# -- make sure we can find vw first
+if [ -x "$VW" ]; then
+    : cool found vw at: $VW
+else
+    echo "$NAME: can not find 'vw' in $PATH - sorry"
+    exit 1
+fi
+
+cleanup() {
+    /bin/rm -f $CACHE $MODEL $STDERR $NAME.*.predict
+}
+
+fail() {
+    echo "$NAME FAILED: $1"
+    cleanup
+    exit 1
+}
+
+# the average loss vw printed to $STDERR
+average_loss() {
+    sed -n 's/^average loss = //p' $STDERR
+}
+
+# whether losses $1 and $2 are within TOLERANCE of each other
+close() {
+    awk -v a="$1" -v b="$2" -v t=$TOLERANCE 'BEGIN { d = a - b; exit !(d <= t && -d <= t) }'
+}
+
+cleanup
+case "$1" in
+train)
+    $VW -k --cache_file $CACHE -d $TRAINSET --passes 3 --holdout_off 2>$STDERR \
+        || fail "one thread failed"
+    one=`average_loss`
+    $VW --cache_file $CACHE --passes 3 --holdout_off --threads 2 2>$STDERR \
+        || fail "two threads failed"
+    two=`average_loss`
+    [ -n "$one" -a -n "$two" ] || fail "no average loss"
+    close $one $two || fail "loss of two threads $two is not near $one"
+    echo "$NAME: train: the loss of two threads is that of one"
+    ;;
+predict)
+    $VW -d $TRAINSET -f $MODEL --quiet || fail "training failed"
+    $VW -t -i $MODEL -d $TRAINSET -p $NAME.1.predict 2>$STDERR \
+        || fail "one thread failed"
+    one=`average_loss`
+    $VW -t -i $MODEL -d $TRAINSET -p $NAME.2.predict --threads 2 2>$STDERR \
+        || fail "two threads failed"
+    two=`average_loss`
+    [ -n "$one" -a -n "$two" ] || fail "no average loss"
+    close $one $two || fail "loss of two threads $two is not near $one"
+    # the threads write predictions as they finish
+    diff <(sort $NAME.1.predict) <(sort $NAME.2.predict) >/dev/null \
+        || fail "the predictions of two threads are not those of one"
+    echo "$NAME: predict: two threads predict as one does"
+    ;;
+refuse)
+    $VW -d $TRAINSET --threads 2 --sparse_weights >/dev/null 2>$STDERR
+    grep -q "^vw (.*): --threads can't be combined with --sparse_weights" $STDERR \
+        || fail "--threads 2 --sparse_weights was not refused"
+    grep -q "^number of examples = 0$" $STDERR \
+        || fail "--threads 2 --sparse_weights learned before it was refused"
+    echo "$NAME: refuse: --threads 2 --sparse_weights is refused"
+    ;;
+*)
+    fail "usage: $0 train|predict|refuse"
+    ;;
+esac
+
+cleanup
+exit 0
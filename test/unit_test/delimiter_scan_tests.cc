@@ -0,0 +1,39 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+
+#include <string>
+#include <vector>
+
+#include "delimiter_scan.h"
+
+BOOST_AUTO_TEST_CASE(delimiter_scan_matches_scalar)
+{
+  std::string line = "1 0.5 'tag|a b:2 c\td|ns:0.5 ";
+  while (line.size() < 300)
+    line += "feature_" + std::to_string(line.size()) + ":1.5 |x y\r";
+
+  for (size_t n = 0; n <= line.size(); n++)
+  {
+    std::vector<uint64_t> expected(delimiter_words(n) + 1, 0), actual(delimiter_words(n) + 1, 0);
+    find_delimiters_scalar(line.data(), n, expected.data());
+    find_delimiters(line.data(), n, actual.data());
+    BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(), expected.begin(), expected.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(delimiter_scan_next_delimiter)
+{
+  std::string line(150, 'a');
+  line[3] = ' ';
+  line[70] = ':';
+  line[149] = '|';
+  std::vector<uint64_t> mask(delimiter_words(line.size()));
+  find_delimiters(line.data(), line.size(), mask.data());
+
+  BOOST_CHECK_EQUAL(next_delimiter(mask.data(), 0, line.size()), 3u);
+  BOOST_CHECK_EQUAL(next_delimiter(mask.data(), 3, line.size()), 3u);
+  BOOST_CHECK_EQUAL(next_delimiter(mask.data(), 4, line.size()), 70u);
+  BOOST_CHECK_EQUAL(next_delimiter(mask.data(), 71, line.size()), 149u);
+}
@@ -0,0 +1,49 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+
+#include <string>
+#include <vector>
+
+#include "lz_codec.h"
+
+std::vector<char> round_trip(const std::string& s, size_t& compressed)
+{
+  std::vector<char> packed(LZ::compress_bound(s.size()));
+  compressed = LZ::compress(s.data(), s.size(), packed.data());
+  std::vector<char> raw(s.size());
+  BOOST_CHECK(LZ::decompress(packed.data(), compressed, raw.data(), raw.size()));
+  return raw;
+}
+
+BOOST_AUTO_TEST_CASE(lz_codec_round_trip)
+{
+  std::string repeated;
+  for (int i = 0; i < 1000; i++)
+    repeated += "|f 1:0.5 2:0.25 " + std::to_string(i % 37) + "\n";
+
+  for (const std::string& s : { std::string(), std::string("a"), std::string("0123456789abc"), std::string(300, 'x'), repeated })
+  {
+    size_t compressed;
+    std::vector<char> raw = round_trip(s, compressed);
+    BOOST_CHECK_EQUAL_COLLECTIONS(raw.begin(), raw.end(), s.begin(), s.end());
+    BOOST_CHECK(compressed <= LZ::compress_bound(s.size()));
+  }
+
+  size_t compressed;
+  round_trip(repeated, compressed);
+  BOOST_CHECK(compressed < repeated.size() / 4);
+}
+
+BOOST_AUTO_TEST_CASE(lz_codec_rejects_bad_input)
+{
+  std::string s(1000, 'y');
+  std::vector<char> packed(LZ::compress_bound(s.size()));
+  size_t compressed = LZ::compress(s.data(), s.size(), packed.data());
+  std::vector<char> raw(s.size() + 1);
+
+  BOOST_CHECK(!LZ::decompress(packed.data(), compressed - 1, raw.data(), s.size()));
+  BOOST_CHECK(!LZ::decompress(packed.data(), compressed, raw.data(), s.size() + 1));
+  BOOST_CHECK(!LZ::decompress(packed.data(), compressed, raw.data(), s.size() - 1));
+}
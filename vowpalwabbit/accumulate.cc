@@ -14,6 +14,7 @@ Alekh Agarwal and John Langford, with help Olivier Chapelle.
 #include <stdint.h>
 #include "global_data.h"
 #include "vw_allreduce.h"
+#include "gd.h"
 
 using namespace std;
 
@@ -91,13 +92,29 @@ float min_elem(float* arr, int length)
   return min;
 }
 
+template<class T>
+float adaptive_state(vw& all, T& weights, uint64_t i)
+{
+  float* weight = &weights[i << weights.stride_shift()];
+  return all.half_state ? GD::half_adaptive(weight) : weight[1];
+}
+
 template<class T>
 void do_weighting(vw& all, uint64_t length, float* local_weights, T& weights)
 {
   for (uint64_t i = 0; i < length; i++)
   {
     float* weight = &weights[i << weights.stride_shift()];
-    if (local_weights[i] > 0)
+    if (local_weights[i] > 0 && all.half_state)
+    {
+      float ratio = GD::half_adaptive(weight) / local_weights[i];
+      local_weights[i] = weight[0] * ratio;
+      weight[0] *= ratio;
+      GD::set_half_adaptive(weight, GD::half_adaptive(weight) * ratio, 0x8000);
+      if (all.normalized_updates)
+        GD::set_half_normalized(weight, GD::half_normalized(weight) * ratio);
+    }
+    else if (local_weights[i] > 0)
     {
       float ratio = weight[1] / local_weights[i];
       local_weights[i] = weight[0] * ratio;
@@ -114,6 +131,31 @@ void do_weighting(vw& all, uint64_t length, float* local_weights, T& weights)
   }
 }
 
+// the weights and, unpacked, the adaptive and normalized sums --half_state keeps as two bfloat16s in w[1],
+// which summed as a float would be garbage
+void all_reduce_half_state(vw& all, dense_parameters& weights, uint64_t length)
+{
+  float* state = new float[3 * length];
+  for (uint64_t i = 0; i < length; i++)
+  {
+    float* weight = &weights[i << weights.stride_shift()];
+    state[3 * i] = weight[0];
+    state[3 * i + 1] = GD::half_adaptive(weight);
+    state[3 * i + 2] = GD::half_normalized(weight);
+  }
+
+  all_reduce<float, add_float>(all, state, 3 * length);
+
+  for (uint64_t i = 0; i < length; i++)
+  {
+    float* weight = &weights[i << weights.stride_shift()];
+    weight[0] = state[3 * i];
+    GD::set_half_adaptive(weight, state[3 * i + 1], 0x8000);
+    GD::set_half_normalized(weight, state[3 * i + 2]);
+  }
+  delete[] state;
+}
+
 void accumulate_weighted_avg(vw& all, parameters& weights)
 {
   if(!all.adaptive)
@@ -126,10 +168,10 @@ void accumulate_weighted_avg(vw& all, parameters& weights)
 
   if (weights.sparse)
     for (uint64_t i = 0; i < length; i++)
-      local_weights[i] = (&(weights.sparse_weights[i << weights.sparse_weights.stride_shift()]))[1];
+      local_weights[i] = adaptive_state(all, weights.sparse_weights, i);
   else
     for (uint64_t i = 0; i < length; i++)
-      local_weights[i] = (&(weights.dense_weights[i << weights.dense_weights.stride_shift()]))[1];
+      local_weights[i] = adaptive_state(all, weights.dense_weights, i);
 
   //First compute weights for averaging
   all_reduce<float, add_float>(all, local_weights, length);
@@ -141,6 +183,8 @@ void accumulate_weighted_avg(vw& all, parameters& weights)
 
   if (weights.sparse)
     cout << "sparse parameters not supported with parallel computation!" << endl;
+  else if (all.half_state)
+    all_reduce_half_state(all, weights.dense_weights, length);
   else
     all_reduce<float, add_float>(all, weights.dense_weights.first(), ((size_t)length)*weights.stride_shift());
   delete[] local_weights;
@@ -1,6 +1,5 @@
 #pragma once
 #include <string.h>
-#include <unordered_map>
 #ifndef _WIN32
 #include <sys/mman.h>
 #endif
@@ -12,16 +11,87 @@
 #endif
 
 #include "array_parameters_dense.h"
+#include "array_parameters_quantized.h"
 
-class sparse_parameters;
-typedef std::unordered_map<uint64_t, weight*> weight_map;
+// An open addressing table of weight blocks: slot i holds the weights of
+// index keys[i] inline at blocks + i * stride.  Lookups probe linearly from a
+// multiplicative hash of the index, and the table doubles before it is half
+// full, so a weight reference is only good until the next new index is added.
+struct weight_table
+{
+	static const uint64_t empty_key = ~(uint64_t)0;
+
+	uint64_t* keys;
+	weight* blocks;
+	uint64_t capacity; // a power of 2
+	uint64_t size;
+	uint32_t shift;    // 64 - log2(capacity)
+	uint32_t stride;
+
+	weight_table(uint32_t stride_in) : keys(nullptr), blocks(nullptr), capacity(0), size(0), shift(64), stride(stride_in)
+	{ resize(16, stride_in); }
+
+	~weight_table()
+	{
+		free(keys);
+		free(blocks);
+	}
+
+	inline uint64_t home(uint64_t key) const { return (key * 0x9E3779B97F4A7C15ULL) >> shift; }
+
+	// the slot holding key, or the empty slot where it belongs
+	inline uint64_t find(uint64_t key) const
+	{
+		uint64_t slot = home(key);
+		while (keys[slot] != key && keys[slot] != empty_key)
+			slot = (slot + 1) & (capacity - 1);
+		return slot;
+	}
+
+	inline weight* block(uint64_t slot) const { return blocks + slot * stride; }
+
+	// moves every block into a table of new_capacity slots of new_stride weights
+	void resize(uint64_t new_capacity, uint32_t new_stride)
+	{
+		uint64_t* old_keys = keys;
+		weight* old_blocks = blocks;
+		uint64_t old_capacity = capacity;
+		uint32_t old_stride = stride;
+
+		keys = calloc_or_throw<uint64_t>(new_capacity);
+		for (uint64_t i = 0; i < new_capacity; i++)
+			keys[i] = empty_key;
+		blocks = calloc_or_throw<weight>(new_capacity * new_stride);
+		capacity = new_capacity;
+		shift = 64;
+		for (uint64_t c = new_capacity; c > 1; c >>= 1)
+			shift--;
+		stride = new_stride;
+
+		for (uint64_t i = 0; i < old_capacity; i++)
+			if (old_keys[i] != empty_key)
+			{
+				uint64_t slot = find(old_keys[i]);
+				keys[slot] = old_keys[i];
+				memcpy(block(slot), old_blocks + i * old_stride, sizeof(weight) * (old_stride < new_stride ? old_stride : new_stride));
+			}
+		free(old_keys);
+		free(old_blocks);
+	}
+};
 
 template <typename T>
 class sparse_iterator
 {
 private:
-	weight_map::iterator _iter;
-	uint32_t _stride;
+	weight_table* _table;
+	uint64_t _slot;
+
+	void skip_empty()
+	{
+		while (_slot < _table->capacity && _table->keys[_slot] == weight_table::empty_key)
+			_slot++;
+	}
 
 public:
 	typedef std::forward_iterator_tag iterator_category;
@@ -30,36 +100,30 @@ public:
 	typedef  T* pointer;
 	typedef  T& reference;
 
-	sparse_iterator(weight_map::iterator& iter, uint32_t stride)
-		: _iter(iter), _stride(stride)
-	{ }
+	sparse_iterator(weight_table* table, uint64_t slot)
+		: _table(table), _slot(slot)
+	{ skip_empty(); }
 
-	sparse_iterator& operator=(const sparse_iterator& other)
-	{
-		_iter = other._iter;
-		_stride = other._stride;
-		return *this;
+	uint64_t index() { return _table->keys[_slot]; }
 
-	}
-	uint64_t index() { return _iter->first; }
-
-	T& operator*() { return *(_iter->second); }
+	T& operator*() { return *_table->block(_slot); }
 
 	sparse_iterator& operator++()
 	{
-		_iter++;
+		_slot++;
+		skip_empty();
 		return *this;
 	}
 
-	bool operator==(const sparse_iterator& rhs) const { return _iter == rhs._iter; }
-	bool operator!=(const sparse_iterator& rhs) const { return _iter != rhs._iter; }
+	bool operator==(const sparse_iterator& rhs) const { return _slot == rhs._slot; }
+	bool operator!=(const sparse_iterator& rhs) const { return _slot != rhs._slot; }
 };
 
 
 class sparse_parameters
 {
 private:
-	weight_map _map;
+	weight_table* _table; // shared with instances seeded from this one
 	uint64_t _weight_mask;  // (stride*(1 << num_bits) -1)
 	uint32_t _stride_shift;
 	bool _seeded; // whether the instance is sharing model state with others
@@ -74,7 +138,7 @@ public:
  public:
 
 	sparse_parameters(size_t length, uint32_t stride_shift = 0)
-		: _map(),
+		: _table(new weight_table(1 << stride_shift)),
 		_weight_mask((length << stride_shift) - 1),
 		_stride_shift(stride_shift),
 		_seeded(false), _delete(false), default_data(nullptr),
@@ -82,60 +146,71 @@ public:
 	{ default_value = calloc_mergable_or_throw<weight>(stride());}
 
 	sparse_parameters()
-		: _map(), _weight_mask(0), _stride_shift(0), _seeded(false), _delete(false), default_data(nullptr), fun(nullptr)
+		: _table(new weight_table(1)), _weight_mask(0), _stride_shift(0), _seeded(false), _delete(false), default_data(nullptr), fun(nullptr)
 	{ default_value = calloc_mergable_or_throw<weight>(stride());}
 
-	bool not_null() { return (_weight_mask > 0 && !_map.empty()); }
+	bool not_null() { return (_weight_mask > 0 && _table->size > 0); }
 
-	sparse_parameters(const sparse_parameters &other) { shallow_copy(other); }
+	sparse_parameters(const sparse_parameters &other)
+		: _table(nullptr), _seeded(true), _delete(false), default_data(nullptr), default_value(nullptr), fun(nullptr)
+	{ shallow_copy(other); }
 	sparse_parameters(sparse_parameters &&) = delete;
 
 	weight* first() { throw 1; } //TODO: Throw better exceptions. Allreduce currently not supported in sparse.
 
 	//iterator with stride
-	iterator begin() { weight_map::iterator i = _map.begin(); return iterator(i, stride()); }
-	iterator end() { weight_map::iterator i = _map.end(); return iterator(i, stride()); }
+	iterator begin() { return iterator(_table, 0); }
+	iterator end() { return iterator(_table, _table->capacity); }
 
 	//const iterator
-	const_iterator cbegin() { weight_map::iterator i = _map.begin(); return const_iterator(i,  stride()); }
-	const_iterator cend() { weight_map::iterator i = _map.begin(); return const_iterator(i, stride()); }
+	const_iterator cbegin() { return const_iterator(_table, 0); }
+	const_iterator cend() { return const_iterator(_table, _table->capacity); }
+
+	//a lookup may insert, so the kernels don't look ahead in sparse weights
+	inline void prefetch(size_t) const {}
 
+	uint32_t prefetch_distance() const { return 0; }
+
+	// inserts the weights of i when they are missing, which may grow the table and move every block:
+	// a reference or pointer from an earlier lookup of another index is invalid after it
 	inline weight& operator[](size_t i)
 	{   uint64_t index = i & _weight_mask;
-    weight_map::iterator iter = _map.find(index);
-		if (iter == _map.end())
-		  {     _map.insert(std::make_pair(index, calloc_mergable_or_throw<weight>(stride())));
-			iter = _map.find(index);
+		weight_table& t = *_table;
+		uint64_t slot = t.find(index);
+		if (t.keys[slot] == weight_table::empty_key)
+		  {     if (2 * (t.size + 1) > t.capacity)
+			  {
+				t.resize(2 * t.capacity, t.stride);
+				slot = t.find(index);
+			  }
+			t.keys[slot] = index;
+			t.size++;
 			if (fun != nullptr)
-        fun(iter->second, default_data);
+        fun(t.block(slot), default_data);
 		}
-		return *(iter->second);
+		return *t.block(slot);
 	}
 
   inline const weight& operator[](size_t i) const
 	{   uint64_t index = i & _weight_mask;
-		weight_map::const_iterator iter = _map.find(index);
-		if (iter == _map.end())
+		uint64_t slot = _table->find(index);
+		if (_table->keys[slot] == weight_table::empty_key)
       return *default_value;
-		return *(iter->second);
+		return *_table->block(slot);
   }
 
 	inline weight& strided_index(size_t index) { return operator[](index << _stride_shift); }
 
 	void shallow_copy(const sparse_parameters& input)
 	{
-		// TODO: this is level-1 copy (weight* are stilled shared)
 		if (!_seeded)
-		{
-		  for (auto iter = _map.begin(); iter != _map.end(); ++iter)
-				free(iter->second);
-		}
-		_map = input._map;
+		  delete _table;
+		_table = input._table;
 		_weight_mask = input._weight_mask;
 		_stride_shift = input._stride_shift;
     free(default_value);
     default_value = calloc_mergable_or_throw<weight>(stride());
-    memcpy(default_value, input.default_value, stride());
+    memcpy(default_value, input.default_value, sizeof(weight) * stride());
     default_data = input.default_data;
 		_seeded = true;
 	}
@@ -153,8 +228,8 @@ public:
 
 	void set_zero(size_t offset)
 	{
-		for (weight_map::iterator iter = _map.begin(); iter != _map.end(); ++iter)
-			(&(*(iter->second)))[offset] = 0;
+		for (iterator iter = begin(); iter != end(); ++iter)
+			(&(*iter))[offset] = 0;
 	}
 
 	uint64_t mask()	const { return _weight_mask; }
@@ -167,6 +242,7 @@ public:
 
 	void stride_shift(uint32_t stride_shift) {
     _stride_shift = stride_shift;
+    _table->resize(_table->capacity, stride());
     free(default_value);
     default_value = calloc_mergable_or_throw<weight>(stride());
     if (fun != nullptr)
@@ -182,9 +258,7 @@ public:
 	~sparse_parameters()
 	{if (!_delete && !_seeded)  // don't free weight vector if it is shared with another instance
 		{
-    for (auto iter = _map.begin(); iter != _map.end(); ++iter)
-      free(iter->second);
-    _map.clear();
+    delete _table;
 		 _delete = true;
 		}
     if (default_data != nullptr)
@@ -196,8 +270,13 @@ public:
 class parameters {
  public:
   bool sparse;
+  weight_pages pages; // how dense_weights is allocated
+  uint32_t prefetch_distance; // of dense_weights
   dense_parameters dense_weights;
   sparse_parameters sparse_weights;
+  uint32_t serving_bits; // 8 or 16 when a serving model loaded int8_weights or fp16_weights, which predictions read instead
+  int8_parameters int8_weights;
+  fp16_parameters fp16_weights;
 
   inline weight& operator[](size_t i)
   {
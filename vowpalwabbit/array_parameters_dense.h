@@ -2,6 +2,10 @@
 
 #include <cstdint>
 #include "memory.h"
+#include "weight_pages.h"
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#endif
 
 typedef float weight;
 
@@ -44,25 +48,43 @@ private:
   weight * _begin;
   uint64_t _weight_mask;  // (stride*(1 << num_bits) -1)
   uint32_t _stride_shift;
+  size_t _mapped; // bytes mapped by alloc_weight_pages, 0 when _begin is from calloc
+  uint32_t _prefetch_distance; // features the kernels look ahead, 0 to not prefetch
   bool _seeded; // whether the instance is sharing model state with others
 
+  void release()
+  {
+    if (_mapped > 0)
+      free_weight_pages(_begin, _mapped);
+    else
+      free(_begin);
+    _mapped = 0;
+  }
+
 public:
   typedef dense_iterator<weight> iterator;
   typedef dense_iterator<const weight> const_iterator;
-  dense_parameters(size_t length, uint32_t stride_shift = 0)
-    : _begin(calloc_mergable_or_throw<weight>(length << stride_shift)),
+  dense_parameters(size_t length, uint32_t stride_shift = 0, const weight_pages& pages = weight_pages())
+    : _begin(nullptr),
     _weight_mask((length << stride_shift) - 1),
     _stride_shift(stride_shift),
+    _mapped(0),
+    _prefetch_distance(0),
     _seeded(false)
-  { }
+  {
+    if (pages.mapped())
+      _begin = (weight*)alloc_weight_pages((length << stride_shift) * sizeof(weight), pages, _mapped);
+    else
+      _begin = calloc_mergable_or_throw<weight>(length << stride_shift);
+  }
 
   dense_parameters()
-    : _begin(nullptr), _weight_mask(0), _stride_shift(0), _seeded(false)
+    : _begin(nullptr), _weight_mask(0), _stride_shift(0), _mapped(0), _prefetch_distance(0), _seeded(false)
   {}
 
   bool not_null() { return (_weight_mask > 0 && _begin != nullptr); }
 
-  dense_parameters(const dense_parameters &other) { shallow_copy(other); }
+  dense_parameters(const dense_parameters &other) : _begin(nullptr), _mapped(0), _prefetch_distance(0), _seeded(false) { shallow_copy(other); }
   dense_parameters(dense_parameters &&) = delete;
 
   weight* first() { return _begin; } //TODO: Temporary fix for allreduce.
@@ -76,13 +98,29 @@ public:
   const_iterator cend() { return const_iterator(_begin + _weight_mask + 1, _begin, stride()); }
 
   inline weight& operator[](size_t i) const { return _begin[i & _weight_mask]; }
+
+  //starts loading the cache line of weight i, which a kernel will use _prefetch_distance features later
+  inline void prefetch(size_t i) const
+  {
+#ifdef _MSC_VER
+    _mm_prefetch((const char*)&_begin[i & _weight_mask], _MM_HINT_T0);
+#else
+    __builtin_prefetch(&_begin[i & _weight_mask]);
+#endif
+  }
+
+  uint32_t prefetch_distance() const { return _prefetch_distance; }
+
+  void prefetch_distance(uint32_t distance) { _prefetch_distance = distance; }
+
   void shallow_copy(const dense_parameters& input)
   {
     if (!_seeded)
-      free(_begin);
+      release();
     _begin = input._begin;
     _weight_mask = input._weight_mask;
     _stride_shift = input._stride_shift;
+    _prefetch_distance = input._prefetch_distance;
     _seeded = true;
   }
 
@@ -112,6 +150,21 @@ public:
 
   uint64_t seeded() const { return _seeded; }
 
+  //runs off memory from alloc_weight_pages or map_weight_file, which is unmapped with the weights
+  void use_mapping(weight* data, size_t mapped_length)
+  {
+    if (!_seeded)
+      release();
+    _begin = data;
+    _mapped = mapped_length;
+  }
+
+  //points at other weights of the same size that outlive these, as --hot_swap switches between shared buffers
+  void use_shared(weight* data) { _begin = data; }
+
+  //the page sizes backing the weights, when they were mapped with --huge_pages or --numa_interleave
+  std::string pages_description() const { return describe_weight_pages(_begin, _mapped); }
+
   uint32_t stride() const { return 1 << _stride_shift; }
 
   uint32_t stride_shift() const { return _stride_shift; }
@@ -127,8 +180,9 @@ public:
     size_t float_count = length << _stride_shift;
     weight* dest = shared_weights;
     memcpy(dest, _begin, float_count * sizeof(float));
-    free(_begin);
+    release();
     _begin = dest;
+    _mapped = float_count * sizeof(float);
   }
 #endif
 #endif
@@ -137,7 +191,7 @@ public:
   {
     if (_begin != nullptr && !_seeded)  // don't free weight vector if it is shared with another instance
     {
-      free(_begin);
+      release();
       _begin = nullptr;
     }
   }
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include "memory.h"
+#include "floatbits.h"
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#endif
+
+// Weights of a model exported with --export_serving_model: one 8 or 16 bit
+// value per index instead of a float stride block, which a predicting vw
+// turns back into a float as a kernel reads it.  They are read only, so
+// operator[] returns the weight by value.
+
+const uint32_t int8_block_shift = 6; // 64 consecutive int8 weights share a scale
+
+// the half float nearest to f, saturated to the largest finite half
+static inline uint16_t float_to_half(float f)
+{
+  uint32_t x = float_to_bits(f);
+  uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+  x &= 0x7fffffff;
+  if (x >= 0x477ff000) // 65520 and above round to infinity
+    return sign | 0x7bff;
+  if (x < 0x38800000) // below the smallest normal half, in units of the smallest subnormal 2^-24
+    return sign | (uint16_t)lrintf(bits_to_float(x) * 16777216.f);
+  x += 0xfff + ((x >> 13) & 1); // round to nearest even
+  return sign | (uint16_t)((x - 0x38000000) >> 13);
+}
+
+// exact for every finite half: moving the bits into a float leaves the exponent 112 short
+static inline float half_to_float(uint16_t h)
+{
+  return bits_to_float(((uint32_t)(h & 0x8000) << 16) | ((uint32_t)(h & 0x7fff) << 13)) * bits_to_float(0x77800000);
+}
+
+template <typename T>
+class quantized_parameters
+{
+protected:
+  T* _values;
+  uint64_t _weight_mask;  // (stride*(1 << num_bits) -1) of the float weights it stands in for
+  uint32_t _stride_shift;
+  uint32_t _prefetch_distance;
+
+  inline size_t slot(size_t i) const { return (i & _weight_mask) >> _stride_shift; }
+
+public:
+  quantized_parameters() : _values(nullptr), _weight_mask(0), _stride_shift(0), _prefetch_distance(0) {}
+  quantized_parameters(const quantized_parameters&) = delete;
+  ~quantized_parameters() { free(_values); }
+
+  // room for length weights, looked up with the indices of a float array of the given stride
+  void allocate(size_t length, uint32_t stride_shift, uint32_t prefetch_distance)
+  {
+    free(_values);
+    _values = calloc_or_throw<T>(length);
+    _weight_mask = (length << stride_shift) - 1;
+    _stride_shift = stride_shift;
+    _prefetch_distance = prefetch_distance;
+  }
+
+  T* values() { return _values; }
+
+  inline void prefetch(size_t i) const
+  {
+#ifdef _MSC_VER
+    _mm_prefetch((const char*)&_values[slot(i)], _MM_HINT_T0);
+#else
+    __builtin_prefetch(&_values[slot(i)]);
+#endif
+  }
+
+  uint32_t prefetch_distance() const { return _prefetch_distance; }
+
+  uint64_t mask() const { return _weight_mask; }
+
+  uint32_t stride_shift() const { return _stride_shift; }
+};
+
+// int8 weights, each block of 1 << int8_block_shift scaled by its largest magnitude / 127
+class int8_parameters : public quantized_parameters<int8_t>
+{
+private:
+  float* _scales;
+
+public:
+  int8_parameters() : _scales(nullptr) {}
+  ~int8_parameters() { free(_scales); }
+
+  void allocate(size_t length, uint32_t stride_shift, uint32_t prefetch_distance)
+  {
+    quantized_parameters<int8_t>::allocate(length, stride_shift, prefetch_distance);
+    free(_scales);
+    _scales = calloc_or_throw<float>(scales(length));
+  }
+
+  static size_t scales(size_t length) { return (length + (1 << int8_block_shift) - 1) >> int8_block_shift; }
+
+  float* scales() { return _scales; }
+
+  inline float operator[](size_t i) const
+  {
+    size_t j = slot(i);
+    return _values[j] * _scales[j >> int8_block_shift];
+  }
+};
+
+// IEEE half float weights
+class fp16_parameters : public quantized_parameters<uint16_t>
+{
+public:
+  inline float operator[](size_t i) const { return half_to_float(_values[slot(i)]); }
+};
@@ -0,0 +1,66 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#include <stdio.h>
+#include <errno.h>
+#include <chrono>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+#include "background_checkpoint.h"
+#include "parse_regressor.h"
+#include "vw_exception.h"
+
+using namespace std;
+
+void wait_for_checkpoint(vw& all)
+{
+  background_checkpoint& c = *all.checkpoint;
+  if (c.child == 0)
+    return;
+#ifndef _WIN32
+  int status;
+  while (waitpid(c.child, &status, 0) < 0 && errno == EINTR);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    all.opts_n_args.trace_message << "warning: the background checkpoint to " << c.file << " failed" << endl;
+#endif
+  c.child = 0;
+}
+
+void save_in_background(vw& all, string file_name)
+{
+  if (file_name == string(""))
+    return;
+  background_checkpoint& c = *all.checkpoint;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  wait_for_checkpoint(all);
+#ifdef _WIN32
+  dump_regressor(all, file_name, false);
+#else
+  fflush(stderr);
+  int child = fork();
+  if (child < 0)
+    THROWERRNO("fork for --background_checkpoints");
+  if (child == 0)
+  { // the child only writes the snapshot, and leaves without running the parent's destructors
+    int status = 0;
+    try
+    {
+      dump_regressor(all, file_name, false);
+    }
+    catch (exception& e)
+    {
+      fprintf(stderr, "background checkpoint to %s: %s\n", file_name.c_str(), e.what());
+      status = 1;
+    }
+    _exit(status);
+  }
+  c.child = child;
+  c.file = file_name;
+#endif
+  c.saves++;
+  c.paused += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
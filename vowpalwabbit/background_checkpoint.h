@@ -0,0 +1,29 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#pragma once
+#include <string>
+#include "global_data.h"
+
+/* --background_checkpoints: a model saved per pass or by a save command is
+   written by a forked child, whose copy on write image of the learner is the
+   snapshot, while learning goes on in the parent.  The child writes a
+   .writing file and renames it when done, so the model file is always whole.
+   One checkpoint is written at a time; a save while one is in flight waits
+   for it, and that wait counts toward the time learning was paused.  The
+   weights of --daemon are shared memory, which fork does not copy, and the
+   child has none of the threads of --threads, so neither is allowed with it. */
+struct background_checkpoint
+{
+  int child;         // writing file, 0 when none is in flight
+  std::string file;
+  size_t saves;
+  double paused;     // seconds learning waited for saves
+};
+
+//snapshots the model and writes it to file_name in the background
+void save_in_background(vw& all, std::string file_name);
+//returns once the checkpoint in flight, if any, is written
+void wait_for_checkpoint(vw& all);
@@ -3,9 +3,16 @@ Copyright (c) by respective owners including Yahoo!, Microsoft, and
 individual contributors. All rights reserved.  Released under a BSD (revised)
 license as described in the file LICENSE.
  */
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include "cache.h"
+#include "lz_codec.h"
 #include "unique_sort.h"
 #include "global_data.h"
+#include "rand48.h"
 #include "vw.h"
 
 using namespace std;
@@ -64,28 +71,31 @@ __attribute__((packed))
 
 int read_cached_features(vw* all, v_array<example*>& examples)
 {
-  example* ae = examples[0];
+  return (int)read_cached_example(all, all->sd, *all->p->input, examples[0]);
+}
+
+size_t read_cached_example(vw* all, shared_data* sd, io_buf& input, example* ae)
+{
   ae->sorted = all->p->sorted_cache;
-  io_buf* input = all->p->input;
 
-  size_t total = all->p->lp.read_cached_label(all->sd, &ae->l, *input);
+  size_t total = all->p->lp.read_cached_label(sd, &ae->l, input);
   if (total == 0)
     return 0;
-  if (read_cached_tag(*input,ae) == 0)
+  if (read_cached_tag(input,ae) == 0)
     return 0;
   char* c;
   unsigned char num_indices = 0;
-  if (buf_read(*input, c, sizeof(num_indices)) < sizeof(num_indices))
+  if (buf_read(input, c, sizeof(num_indices)) < sizeof(num_indices))
     return 0;
   num_indices = *(unsigned char*)c;
   c += sizeof(num_indices);
 
-  all->p->input->set(c);
+  input.set(c);
   for (; num_indices > 0; num_indices--)
   {
     size_t temp;
     unsigned char index = 0;
-    if((temp = buf_read(*input,c,sizeof(index) + sizeof(size_t))) < sizeof(index) + sizeof(size_t))
+    if((temp = buf_read(input,c,sizeof(index) + sizeof(size_t))) < sizeof(index) + sizeof(size_t))
     {
       all->opts_n_args.trace_message << "truncated example! " << temp << " " << char_size + sizeof(size_t) << endl;
       return 0;
@@ -97,9 +107,9 @@ int read_cached_features(vw* all, v_array<example*>& examples)
     features& ours = ae->feature_space[index];
     size_t storage = *(size_t *)c;
     c += sizeof(size_t);
-    all->p->input->set(c);
+    input.set(c);
     total += storage;
-    if (buf_read(*input,c,storage) < storage)
+    if (buf_read(input,c,storage) < storage)
     {
       all->opts_n_args.trace_message << "truncated example! wanted: " << storage << " bytes" << endl;
       return 0;
@@ -129,10 +139,10 @@ int read_cached_features(vw* all, v_array<example*>& examples)
       last = i;
       ours.push_back(v,i);
     }
-    all->p->input->set(c);
+    input.set(c);
   }
 
-  return (int)total;
+  return total;
 }
 
 inline uint64_t ZigZagEncode(int64_t n)
@@ -208,3 +218,389 @@ void cache_features(io_buf& cache, example* ae, uint64_t mask)
   for (namespace_index ns : ae->indices)
     output_features(cache, ns, ae->feature_space[ns], mask);
 }
+
+memory_io_buf::memory_io_buf()
+{
+  buffer = v_init<char>();
+  files.push_back(-1); // buf_read refills from files[current]
+}
+
+memory_io_buf::~memory_io_buf()
+{
+  if (buffer.begin() != nullptr)
+    space = buffer;
+}
+
+void memory_io_buf::view(char* begin, char* end)
+{
+  if (buffer.begin() == nullptr)
+    buffer = space;
+  space.begin() = begin;
+  space.end() = end;
+  space.end_array = end;
+  head = begin;
+}
+
+void memory_io_buf::flush()
+{
+  size_t used = head - space.begin();
+  space.end() = head; // resize keeps (and does not zero) only [begin, end)
+  space.resize(2 * (space.end_array - space.begin()));
+  head = space.begin() + used;
+}
+
+const size_t read_ahead = 3; // blocks held by a block_reader
+
+struct block_reader
+{
+  vw* all;
+  std::thread thread;
+  std::mutex lock;
+  std::condition_variable loaded;
+  std::condition_variable consumed;
+  v_array<char> slots[read_ahead]; // block i of the pass goes to slots[i % read_ahead]
+  size_t produced; // blocks of the pass ready in a slot
+  size_t released; // blocks of the pass the parser is done with
+  bool stop;
+  std::exception_ptr error;
+};
+
+namespace
+{
+void stop_reader(block_cache& bc)
+{
+  block_reader* r = bc.reader;
+  if (r == nullptr)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(r->lock);
+    r->stop = true;
+    r->consumed.notify_all();
+  }
+  r->thread.join();
+  for (v_array<char>& slot : r->slots)
+    slot.delete_v();
+  delete r;
+  bc.reader = nullptr;
+}
+}
+
+block_cache::block_cache()
+  : write_blocks(false), compress(false), block_size(1 << 20), shuffle(false), random_state(0), file_offset(0),
+    pass_started(false), next_block(0), data(nullptr), record(0), reader(nullptr)
+{
+  packed = v_init<char>();
+  offsets = v_init<uint32_t>();
+  unpacked = v_init<char>();
+  record_ends = v_init<uint32_t>();
+}
+
+block_cache::~block_cache()
+{
+  stop_reader(*this);
+  packed.delete_v();
+  offsets.delete_v();
+  unpacked.delete_v();
+  record_ends.delete_v();
+}
+
+namespace
+{
+const size_t index_entry_bytes = 3 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
+const size_t trailer_bytes = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+
+char* reserve(v_array<char>& a, size_t n)
+{
+  if ((size_t)(a.end_array - a.begin()) < n)
+    a.resize(n);
+  return a.begin();
+}
+
+template<class T> char* read_field(char* c, T& field)
+{
+  memcpy(&field, c, sizeof(T));
+  return c + sizeof(T);
+}
+
+void write_block(vw& all)
+{
+  block_cache& bc = *all.p->blocks;
+  for (uint32_t offset : bc.offsets)
+    bin_write_fixed(bc.block, (char*)&offset, sizeof(offset));
+
+  char* begin = bc.block.space.begin();
+  cache_block b;
+  b.file = 0;
+  b.offset = bc.file_offset;
+  b.raw_bytes = bc.block.head - begin;
+  b.bytes = b.raw_bytes;
+  b.examples = (uint32_t)bc.offsets.size();
+  b.checksum = (uint32_t)uniform_hash(begin, b.raw_bytes, 0);
+  char* stored = begin;
+  if (bc.compress)
+  { // incompressible blocks are kept as they are
+    char* packed = reserve(bc.packed, LZ::compress_bound(b.raw_bytes));
+    size_t bytes = LZ::compress(begin, b.raw_bytes, packed);
+    if (bytes < b.raw_bytes)
+    {
+      b.bytes = bytes;
+      stored = packed;
+    }
+  }
+  bin_write_fixed(*all.p->output, stored, b.bytes);
+
+  bc.written.push_back(b);
+  bc.file_offset += b.bytes;
+  bc.block.head = begin;
+  bc.block.space.end() = begin;
+  bc.offsets.clear();
+}
+
+void read_block_index(vw& all, size_t file)
+{
+  io_buf& input = *all.p->input;
+  int f = input.files[file];
+  input.current = file;
+  char* c;
+  if (input.seek_file(f, -(int64_t)trailer_bytes, SEEK_END) < 0 || buf_read(input, c, trailer_bytes) < trailer_bytes)
+    THROW("block cache is truncated");
+
+  uint64_t index_offset, num_blocks;
+  uint32_t magic;
+  c = read_field(c, index_offset);
+  c = read_field(c, num_blocks);
+  read_field(c, magic);
+  if (magic == cache_blocks_magic_v1)
+    THROW("block cache was written by an older vw with a different index, remove it to have it written again");
+  if (magic != cache_blocks_magic)
+    THROW("block cache has no index, it was probably not written to the end");
+
+  size_t index_bytes = num_blocks * index_entry_bytes;
+  if (input.seek_file(f, index_offset, SEEK_SET) < 0 || buf_read(input, c, index_bytes) < index_bytes)
+    THROW("block cache index is truncated");
+
+  block_cache& bc = *all.p->blocks;
+  for (uint64_t i = 0; i < num_blocks; i++)
+  {
+    cache_block b;
+    b.file = file;
+    c = read_field(c, b.offset);
+    c = read_field(c, b.bytes);
+    c = read_field(c, b.raw_bytes);
+    c = read_field(c, b.examples);
+    c = read_field(c, b.checksum);
+    bc.index.push_back(b);
+  }
+}
+
+//the uncompressed bytes of block b, read from the input; they stay valid until the input or unpacked is used again
+char* read_block(vw& all, cache_block& b, v_array<char>& unpacked)
+{
+  io_buf& input = *all.p->input;
+  input.current = b.file;
+  char* c;
+  if (input.seek_file(input.files[b.file], b.offset, SEEK_SET) < 0 || buf_read(input, c, b.bytes) < b.bytes)
+    THROW("block cache is truncated");
+  if (b.bytes != b.raw_bytes)
+  {
+    char* raw = reserve(unpacked, b.raw_bytes);
+    if (!LZ::decompress(c, b.bytes, raw, b.raw_bytes))
+      THROW("block cache has a corrupt compressed block at offset " << b.offset);
+    c = raw;
+  }
+  if ((uint32_t)uniform_hash(c, b.raw_bytes, 0) != b.checksum)
+    THROW("block cache checksum mismatch at offset " << b.offset);
+  return c;
+}
+
+void read_ahead_blocks(block_reader* r)
+{
+  block_cache& bc = *r->all->p->blocks;
+  for (size_t i = 0; i < bc.order.size(); i++)
+  {
+    {
+      std::unique_lock<std::mutex> lock(r->lock);
+      r->consumed.wait(lock, [r, i] { return r->stop || i - r->released < read_ahead; });
+      if (r->stop)
+        return;
+    }
+
+    v_array<char>& slot = r->slots[i % read_ahead];
+    cache_block& b = bc.index[bc.order[i]];
+    try
+    {
+      char* c = read_block(*r->all, b, slot);
+      if (c != slot.begin())
+        memcpy(reserve(slot, b.raw_bytes), c, b.raw_bytes);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(r->lock);
+      r->error = std::current_exception();
+      r->loaded.notify_all();
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(r->lock);
+    r->produced = i + 1;
+    r->loaded.notify_all();
+  }
+}
+
+void start_pass(vw& all)
+{
+  block_cache& bc = *all.p->blocks;
+  bc.index.clear();
+  for (size_t i = 0; i < all.p->input->files.size(); i++)
+    read_block_index(all, i);
+
+  bc.order.resize(bc.index.size());
+  for (size_t i = 0; i < bc.order.size(); i++)
+    bc.order[i] = i;
+  if (bc.shuffle)
+    for (size_t i = bc.order.size(); i > 1; i--)
+      std::swap(bc.order[i - 1], bc.order[(size_t)(merand48(bc.random_state) * i) % i]);
+
+  bc.next_block = 0;
+  bc.record = 0;
+  bc.record_ends.clear();
+  bc.pass_started = true;
+
+  bool compressed = false;
+  for (cache_block& b : bc.index)
+    compressed |= b.bytes != b.raw_bytes;
+  if (compressed)
+  { // from here on only the reader uses the input until the pass is reset
+    block_reader* r = new block_reader();
+    r->all = &all;
+    for (v_array<char>& slot : r->slots)
+      slot = v_init<char>();
+    r->produced = 0;
+    r->released = 0;
+    r->stop = false;
+    bc.reader = r;
+    r->thread = std::thread(read_ahead_blocks, r);
+  }
+}
+
+void load_block(vw& all, size_t i)
+{
+  block_cache& bc = *all.p->blocks;
+  cache_block& b = bc.index[bc.order[i]];
+  char* c;
+  if (bc.reader == nullptr)
+    c = read_block(all, b, bc.unpacked);
+  else
+  {
+    block_reader* r = bc.reader;
+    std::unique_lock<std::mutex> lock(r->lock);
+    r->released = i; // the records of block i - 1 have all been handed out
+    r->consumed.notify_all();
+    r->loaded.wait(lock, [r, i] { return r->error || r->produced > i; });
+    if (r->error)
+      std::rethrow_exception(r->error);
+    c = r->slots[i % read_ahead].begin();
+  }
+
+  // turn the offset table at the end of the block into the end of each record
+  size_t records_bytes = b.raw_bytes - b.examples * sizeof(uint32_t);
+  char* offsets = c + records_bytes;
+  bc.record_ends.clear();
+  for (uint32_t j = 1; j <= b.examples; j++)
+  {
+    uint32_t end = (uint32_t)records_bytes;
+    if (j < b.examples)
+      read_field(offsets + j * sizeof(uint32_t), end);
+    bc.record_ends.push_back(end);
+  }
+  bc.data = c;
+  bc.record = 0;
+}
+}
+
+void cache_example(vw& all, example* ae)
+{
+  block_cache& bc = *all.p->blocks;
+  if (!bc.write_blocks)
+  {
+    all.p->lp.cache_label(&ae->l, *(all.p->output));
+    cache_features(*(all.p->output), ae, all.parse_mask);
+    return;
+  }
+
+  bc.offsets.push_back((uint32_t)(bc.block.head - bc.block.space.begin()));
+  all.p->lp.cache_label(&ae->l, bc.block);
+  cache_features(bc.block, ae, all.parse_mask);
+  // a block ends with a whole multiline example, whose pieces --shuffle_blocks would otherwise reorder
+  if ((size_t)(bc.block.head - bc.block.space.begin()) >= bc.block_size && (!all.l->is_multiline || example_is_newline(*ae)))
+    write_block(all);
+}
+
+void start_block_cache(vw& all, uint64_t header_bytes)
+{
+  block_cache& bc = *all.p->blocks;
+  bc.block.head = bc.block.space.begin();
+  bc.offsets.clear();
+  bc.written.clear();
+  bc.file_offset = header_bytes;
+}
+
+void finish_block_cache(vw& all)
+{
+  block_cache& bc = *all.p->blocks;
+  if (!bc.write_blocks)
+    return;
+  if (bc.offsets.size() > 0)
+    write_block(all);
+
+  io_buf& output = *all.p->output;
+  uint64_t index_offset = bc.file_offset;
+  uint64_t num_blocks = bc.written.size();
+  for (cache_block& b : bc.written)
+  {
+    bin_write_fixed(output, (char*)&b.offset, sizeof(b.offset));
+    bin_write_fixed(output, (char*)&b.bytes, sizeof(b.bytes));
+    bin_write_fixed(output, (char*)&b.raw_bytes, sizeof(b.raw_bytes));
+    bin_write_fixed(output, (char*)&b.examples, sizeof(b.examples));
+    bin_write_fixed(output, (char*)&b.checksum, sizeof(b.checksum));
+  }
+  bin_write_fixed(output, (char*)&index_offset, sizeof(index_offset));
+  bin_write_fixed(output, (char*)&num_blocks, sizeof(num_blocks));
+  bin_write_fixed(output, (char*)&cache_blocks_magic, sizeof(cache_blocks_magic));
+  bc.written.clear();
+}
+
+void reset_block_cache(vw& all)
+{
+  stop_reader(*all.p->blocks);
+  all.p->blocks->pass_started = false;
+}
+
+bool next_cached_record(vw& all, char*& begin, char*& end)
+{
+  block_cache& bc = *all.p->blocks;
+  if (!bc.pass_started)
+    start_pass(all);
+
+  while (bc.record == bc.record_ends.size())
+  {
+    if (bc.next_block == bc.order.size())
+      return false;
+    load_block(all, bc.next_block++);
+  }
+
+  begin = bc.data + (bc.record == 0 ? 0 : bc.record_ends[bc.record - 1]);
+  end = bc.data + bc.record_ends[bc.record++];
+  return true;
+}
+
+int read_cached_blocks(vw* all, v_array<example*>& examples)
+{
+  block_cache& bc = *all->p->blocks;
+  char* begin;
+  char* end;
+  if (!next_cached_record(*all, begin, end))
+    return 0;
+  bc.record_view.view(begin, end);
+  return (int)read_cached_example(all, all->sd, bc.record_view, examples[0]);
+}
@@ -4,16 +4,109 @@ individual contributors. All rights reserved.  Released under a BSD
 license as described in the file LICENSE.
  */
 #pragma once
+#include <vector>
 #include "v_array.h"
 #include "io_buf.h"
 #include "example.h"
 
+/* A cache file starts with the vw version, a type byte and num_bits.
+
+   Type cache_stream: examples follow one after the other until the end of the file.
+
+   Type cache_blocks (--block_cache): examples are grouped into blocks of about
+   --cache_block_size bytes, so that blocks can be decoded independently and
+   visited in any order.  For a multiline learner a block only ends with the
+   empty line that ends a multiline example.
+     block:   example records, then a uint32 offset of each record in the block
+     index:   per block a uint64 offset, uint64 stored length, uint64 length,
+              uint32 examples, uint32 checksum of the uncompressed block
+     trailer: uint64 offset of the index, uint64 number of blocks, uint32 cache_blocks_magic
+   A record is an example in the stream format, label first.  With
+   --compress_blocks a block is stored compressed (see lz_codec.h) whenever
+   that makes it smaller; such blocks are inflated on a background thread
+   a few blocks ahead of the parser. */
+const char cache_stream = 'c';
+const char cache_blocks = 'b';
+const uint32_t cache_blocks_magic = 0x326b6c62;  // "blk2": index entries with the stored and the uncompressed length
+const uint32_t cache_blocks_magic_v1 = 0x6b636c62; // "blck": index entries with one length, before --compress_blocks
+
 char* run_len_decode(char *p, size_t& i);
 char* run_len_encode(char *p, size_t i);
 
 int read_cached_features(vw* all, v_array<example*>& examples);
+size_t read_cached_example(vw* all, shared_data* sd, io_buf& input, example* ae);
 void cache_tag(io_buf& cache, v_array<char> tag);
 void cache_features(io_buf& cache, example* ae, uint64_t mask);
 void output_byte(io_buf& cache, unsigned char s);
 void output_features(io_buf& cache, unsigned char index, features& fs, uint64_t mask);
 
+//appends ae, label included, to the cache being written
+void cache_example(vw& all, example* ae);
+
+//decodes bytes that are already in memory
+class memory_io_buf : public io_buf
+{
+public:
+  v_array<char> buffer; // the allocated space, parked while space views other bytes
+
+  memory_io_buf();
+  virtual ~memory_io_buf();
+
+  void view(char* begin, char* end);
+
+  virtual ssize_t fill(int) { return 0; }
+  virtual void shift() {}
+  virtual void flush(); // grows space rather than writing it out
+};
+
+struct cache_block
+{
+  size_t file; // position in input->files
+  uint64_t offset;
+  uint64_t bytes;     // as stored in the file
+  uint64_t raw_bytes; // after decompression
+  uint32_t examples;
+  uint32_t checksum;
+};
+
+struct block_reader;
+
+struct block_cache
+{
+  bool write_blocks;
+  bool compress;
+  size_t block_size;
+  bool shuffle;
+  uint64_t random_state;
+
+  // writing
+  memory_io_buf block;
+  v_array<char> packed;
+  v_array<uint32_t> offsets;
+  std::vector<cache_block> written;
+  uint64_t file_offset;
+
+  // reading
+  std::vector<cache_block> index;
+  std::vector<size_t> order; // the blocks of this pass in the order they are read
+  bool pass_started;
+  size_t next_block;
+  char* data;
+  v_array<char> unpacked;
+  v_array<uint32_t> record_ends;
+  size_t record;
+  memory_io_buf record_view;
+  block_reader* reader; // reads and inflates the blocks of a pass ahead of the parser, if any are compressed
+
+  block_cache();
+  ~block_cache();
+};
+
+void start_block_cache(vw& all, uint64_t header_bytes);
+void finish_block_cache(vw& all);
+//ends the pass being read; the input may be used again afterwards
+void reset_block_cache(vw& all);
+
+int read_cached_blocks(vw* all, v_array<example*>& examples);
+//the bytes of the next example record in a block cache; false at the end of the pass
+bool next_cached_record(vw& all, char*& begin, char*& end);
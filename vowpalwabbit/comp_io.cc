@@ -1,5 +1,88 @@
 #include "zlib.h"
 #include "comp_io.h"
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+const size_t gz_chunk = 1 << 17;
+const size_t gz_slots = 3;
+
+struct gz_reader
+{
+  gzFile file;
+  std::thread thread;
+  std::mutex lock;
+  std::condition_variable filled;
+  std::condition_variable emptied;
+  std::vector<char> slots[gz_slots]; // chunk i of the file goes to slots[i % gz_slots]
+  size_t sizes[gz_slots];
+  uint64_t produced; // chunks inflated; the last one is empty at the end of the file
+  uint64_t consumed; // chunks read_file is done with
+  size_t pos;        // bytes of chunk consumed that were handed out
+  bool stop;
+};
+
+namespace
+{
+void inflate_ahead(gz_reader* r)
+{
+  for (bool eof = false; !eof;)
+  {
+    size_t slot;
+    {
+      std::unique_lock<std::mutex> lock(r->lock);
+      r->emptied.wait(lock, [r] { return r->stop || r->produced - r->consumed < gz_slots; });
+      if (r->stop)
+        return;
+      slot = r->produced % gz_slots;
+    }
+
+    int num_read = gzread(r->file, r->slots[slot].data(), (unsigned int)gz_chunk);
+    eof = num_read <= 0;
+
+    std::lock_guard<std::mutex> lock(r->lock);
+    r->sizes[slot] = eof ? 0 : num_read;
+    r->produced++;
+    r->filled.notify_one();
+  }
+}
+}
+
+comp_io_buf::comp_io_buf() : read_ahead(std::thread::hardware_concurrency() > 1) {}
+
+comp_io_buf::~comp_io_buf()
+{
+  for (size_t f = 0; f < readers.size(); f++)
+    stop_reader((int)f);
+}
+
+size_t comp_io_buf::stop_reader(int f)
+{
+  if ((size_t)f >= readers.size() || readers[f] == nullptr)
+    return 0;
+  gz_reader* r = readers[f];
+  {
+    std::lock_guard<std::mutex> lock(r->lock);
+    r->stop = true;
+    r->emptied.notify_one();
+  }
+  r->thread.join();
+
+  size_t unread = 0;
+  for (uint64_t i = r->consumed; i < r->produced; i++)
+    unread += r->sizes[i % gz_slots];
+  if (r->produced > r->consumed)
+    unread -= r->pos;
+  delete r;
+  readers[f] = nullptr;
+  return unread;
+}
 
 int comp_io_buf::open_file(const char* name, bool stdin_off, int flag)
 {
@@ -42,17 +125,72 @@ int comp_io_buf::open_file(const char* name, bool stdin_off, int flag)
 
 void comp_io_buf::reset_file(int f)
 {
+  stop_reader(f);
   gzFile fil = gz_files[f];
   gzseek(fil, 0, SEEK_SET);
   space.end() = space.begin();
   head = space.begin();
 }
 
+int64_t comp_io_buf::seek_file(int f, int64_t offset, int whence)
+{
+  space.end() = space.begin();
+  head = space.begin();
+  if (whence == SEEK_END) // zlib can't seek relative to the end
+    return -1;
+  size_t unread = stop_reader(f);
+  if (whence == SEEK_CUR)
+    offset -= unread;
+  return gzseek(gz_files[f], (z_off_t)offset, whence);
+}
+
 ssize_t comp_io_buf::read_file(int f, void* buf, size_t nbytes)
 {
-  gzFile fil = gz_files[f];
-  int num_read = gzread(fil, buf, (unsigned int)nbytes);
-  return (num_read > 0) ? num_read : 0;
+  if (!read_ahead)
+  {
+    int num_read = gzread(gz_files[f], buf, (unsigned int)nbytes);
+    return (num_read > 0) ? num_read : 0;
+  }
+
+  if ((size_t)f >= readers.size())
+    readers.resize(f + 1, nullptr);
+  gz_reader* r = readers[f];
+  if (r == nullptr)
+  {
+    r = new gz_reader();
+    r->file = gz_files[f];
+    for (std::vector<char>& slot : r->slots)
+      slot.resize(gz_chunk);
+    r->produced = 0;
+    r->consumed = 0;
+    r->pos = 0;
+    r->stop = false;
+    r->thread = std::thread(inflate_ahead, r);
+    readers[f] = r;
+  }
+
+  size_t slot, available;
+  {
+    std::unique_lock<std::mutex> lock(r->lock);
+    r->filled.wait(lock, [r] { return r->produced > r->consumed; });
+    slot = r->consumed % gz_slots;
+    available = r->sizes[slot] - r->pos;
+  }
+  if (available == 0) // the end of the file
+    return 0;
+
+  // the inflating thread leaves the chunk alone until it is consumed
+  size_t num_read = std::min(nbytes, available);
+  memcpy(buf, r->slots[slot].data() + r->pos, num_read);
+  r->pos += num_read;
+  if (r->pos == r->sizes[slot])
+  {
+    std::lock_guard<std::mutex> lock(r->lock);
+    r->consumed++;
+    r->pos = 0;
+    r->emptied.notify_one();
+  }
+  return num_read;
 }
 
 size_t comp_io_buf::num_files() { return gz_files.size(); }
@@ -76,6 +214,7 @@ bool comp_io_buf::close_file()
 {
   if (gz_files.size()>0)
   {
+    stop_reader((int)gz_files.size() - 1);
     gzclose(gz_files.back());
     gz_files.pop_back();
     if (files.size() > 0)
@@ -84,3 +223,165 @@ bool comp_io_buf::close_file()
   }
   return false;
 }
+
+mmap_io_buf::~mmap_io_buf()
+{
+  unalias(false);
+  while (!maps.empty())
+    unmap(maps.back().fd);
+  buffer.delete_v();
+}
+
+mmap_io_buf::mapped_file* mmap_io_buf::find(int fd)
+{
+  for (mapped_file& m : maps)
+    if (m.fd == fd)
+      return &m;
+  return nullptr;
+}
+
+void mmap_io_buf::unalias(bool keep_unread)
+{
+  if (aliased == -1)
+    return;
+  size_t left = keep_unread ? space.end() - head : 0;
+  char* unread = head;
+  space = buffer;
+  buffer = v_init<char>();
+  aliased = -1;
+  if ((size_t)(space.end_array - space.begin()) < left)
+    space.resize(left);
+  memcpy(space.begin(), unread, left);
+  head = space.begin();
+  space.end() = space.begin() + left;
+}
+
+void mmap_io_buf::unmap(int fd)
+{
+  for (size_t i = 0; i < maps.size(); i++)
+    if (maps[i].fd == fd)
+    {
+      if (aliased == fd)
+        unalias(false);
+#ifndef _WIN32
+      munmap(maps[i].data, maps[i].size);
+#endif
+      maps.erase(maps.begin() + i);
+      return;
+    }
+}
+
+int mmap_io_buf::open_file(const char* name, bool stdin_off, int flag)
+{
+  int ret = io_buf::open_file(name, stdin_off, flag);
+#ifndef _WIN32
+  // the descriptor may have been closed behind our back and reused
+  unmap(ret);
+  struct stat st;
+  if (flag == READ && *name != '\0' && fstat(ret, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+  {
+    void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, ret, 0);
+    if (data != MAP_FAILED)
+    {
+      madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+      mapped_file m = { ret, (char*)data, (size_t)st.st_size, 0 };
+      maps.push_back(m);
+    }
+  }
+#endif
+  return ret;
+}
+
+void mmap_io_buf::reset_file(int f)
+{
+  unalias(false);
+  mapped_file* m = find(f);
+  if (m == nullptr)
+    io_buf::reset_file(f);
+  else
+  {
+    m->pos = 0;
+    space.end() = space.begin();
+    head = space.begin();
+  }
+}
+
+int64_t mmap_io_buf::seek_file(int f, int64_t offset, int whence)
+{
+  unalias(false);
+  mapped_file* m = find(f);
+  if (m == nullptr)
+    return io_buf::seek_file(f, offset, whence);
+
+  int64_t base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? (int64_t)m->pos : (int64_t)m->size;
+  if (base + offset < 0 || base + offset > (int64_t)m->size)
+    return -1;
+  m->pos = (size_t)(base + offset);
+  space.end() = space.begin();
+  head = space.begin();
+  return m->pos;
+}
+
+ssize_t mmap_io_buf::read_file(int f, void* buf, size_t nbytes)
+{
+  mapped_file* m = find(f);
+  if (m == nullptr)
+    return io_buf::read_file(f, buf, nbytes);
+
+  size_t n = std::min(nbytes, m->size - m->pos);
+  memcpy(buf, m->data + m->pos, n);
+  m->pos += n;
+  return n;
+}
+
+ssize_t mmap_io_buf::fill(int f)
+{
+  unalias(true);
+  mapped_file* m = find(f);
+  if (m == nullptr)
+    return io_buf::fill(f);
+
+  size_t remaining = m->size - m->pos;
+  if (remaining == 0)
+    return 0;
+
+  if (head == space.end())
+  { // nothing is buffered, so hand out the rest of the file in place
+    buffer = space;
+    space.begin() = m->data + m->pos;
+    space.end() = m->data + m->size;
+    space.end_array = space.end();
+    head = space.begin();
+    m->pos = m->size;
+    aliased = f;
+    return remaining;
+  }
+
+  // unread bytes of an earlier file are buffered, append to them
+  if (space.end_array == space.end())
+  {
+    size_t head_loc = head - space.begin();
+    space.resize(2 * (space.end_array - space.begin()));
+    head = space.begin() + head_loc;
+  }
+  size_t n = std::min(remaining, (size_t)(space.end_array - space.end()));
+  memcpy(space.end(), m->data + m->pos, n);
+  m->pos += n;
+  space.end() += n;
+  return n;
+}
+
+void mmap_io_buf::shift()
+{
+  if (aliased != -1)
+    unalias(true);
+  else
+    io_buf::shift();
+}
+
+bool mmap_io_buf::close_file()
+{
+  if (files.size() > 0)
+    unmap(files.last());
+  return io_buf::close_file();
+}
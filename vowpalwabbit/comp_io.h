@@ -16,15 +16,28 @@ struct gzFile_s;
 typedef struct gzFile_s *gzFile;
 #endif
 
+struct gz_reader;
+
+/* On machines with more than one core, files opened for reading are inflated
+   by a thread of their own a few chunks ahead of read_file, so that
+   decompression overlaps with parsing.  --inflate_ahead sets read_ahead
+   either way. */
 class comp_io_buf : public io_buf
 {
 public:
   std::vector<gzFile> gz_files;
+  bool read_ahead;
+  std::vector<gz_reader*> readers; // per gz file, started by the first read_file
+
+  comp_io_buf();
+  virtual ~comp_io_buf();
 
   virtual int open_file(const char* name, bool stdin_off, int flag = READ);
 
   virtual void reset_file(int f);
 
+  virtual int64_t seek_file(int f, int64_t offset, int whence);
+
   virtual ssize_t read_file(int f, void* buf, size_t nbytes);
 
   virtual size_t num_files();
@@ -36,4 +49,51 @@ public:
   virtual void flush();
 
   virtual bool close_file();
+
+private:
+  //stops the reader of file f, if any; returns the number of inflated bytes it held that were not read
+  size_t stop_reader(int f);
+};
+
+/* Reads regular files through a read-only mapping, so that buf_read and readto
+   return pointers straight into the file rather than into a copy in space.
+   While the unread part of a mapped file is being handed out, space aliases the
+   mapping; stdin, sockets and anything that can't be mapped use the read() path. */
+class mmap_io_buf : public io_buf
+{
+public:
+  struct mapped_file
+  {
+    int fd;
+    char* data;
+    size_t size;
+    size_t pos; // bytes already handed to space
+  };
+
+  std::vector<mapped_file> maps;
+  v_array<char> buffer; // the allocated space, parked here while space aliases a mapping
+  int aliased; // fd of the mapping space points into, -1 when space is the allocated buffer
+
+  mmap_io_buf() : aliased(-1) { buffer = v_init<char>(); }
+
+  virtual ~mmap_io_buf();
+
+  virtual int open_file(const char* name, bool stdin_off, int flag = READ);
+
+  virtual void reset_file(int f);
+
+  virtual int64_t seek_file(int f, int64_t offset, int whence);
+
+  virtual ssize_t read_file(int f, void* buf, size_t nbytes);
+
+  virtual ssize_t fill(int f);
+
+  virtual void shift();
+
+  virtual bool close_file();
+
+private:
+  mapped_file* find(int fd);
+  void unalias(bool keep_unread);
+  void unmap(int fd);
 };
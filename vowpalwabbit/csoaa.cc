@@ -162,6 +162,14 @@ struct ldf
   uint64_t ft_offset;
 
   v_array<action_scores > stored_preds;
+
+  // --ldf_shared_once
+  bool shared_once;
+  float shared_score;                 // added to the prediction of each action
+  vector<string> shared_interactions; // of namespaces of the shared example only
+  vector<string> action_interactions; // the rest, each with a namespace of the actions
+  bool ignore_linear[256];            // of vw, while the shared terms are left out
+  bool ignore_some_linear;
 };
 
 bool ec_is_label_definition(example& ec) // label defs look like "0:___" or just "label:___"
@@ -254,12 +262,129 @@ void make_single_prediction(ldf& data, single_learner& base, example& ec)
   ec.ft_offset = data.ft_offset;
   base.predict(ec); // make a prediction
   ec.ft_offset = old_offset;
+  ec.partial_prediction += data.shared_score;
   ld.costs[0].partial_prediction = ec.partial_prediction;
 
   LabelDict::del_example_namespace_from_memory(data.label_features, ec, ld.costs[0].class_index);
   ec.l.cs = ld;
 }
 
+/* With --ldf_shared_once the score of an action is the score of the shared
+   example alone, computed once per multiline example, plus that of the action
+   with the linear and shared-only interaction terms of the shared namespaces
+   left out.  That's the score of the merged example if the base learner adds
+   up the terms of its features (as gd does), which csldf_setup checks, and
+   holds when no action has a namespace of the shared example, which is
+   checked here. */
+bool split_shared_terms(ldf& data, multi_ex& ec_seq)
+{
+  vw& all = *data.all;
+  example& shared = *ec_seq[0];
+  if (all.audit || all.hash_inv)
+    return false;
+
+  bool in_shared[256] = { false };
+  for (namespace_index idx : shared.indices)
+    if (idx != constant_namespace && shared.feature_space[idx].nonempty())
+      in_shared[idx] = true;
+  if (in_shared[(unsigned char)'l']) // label features are added to the actions as namespace l
+    return false;
+  for (size_t k = 1; k < ec_seq.size(); k++)
+    for (namespace_index idx : ec_seq[k]->indices)
+      if (in_shared[idx] && ec_seq[k]->feature_space[idx].size() > shared.feature_space[idx].size())
+        return false;
+
+  data.shared_interactions.clear();
+  data.action_interactions.clear();
+  for (string& ns : all.interactions)
+  {
+    bool shared_only = true;
+    for (unsigned char idx : ns)
+      shared_only &= in_shared[idx];
+    (shared_only ? data.shared_interactions : data.action_interactions).push_back(ns);
+  }
+  return true;
+}
+
+// while in scope, vw scores only the linear terms of the shared example but the constant, and its shared-only interactions
+struct shared_terms_only
+{
+  vw& all;
+  ldf& data;
+  bool ignore_constant;
+  bool ignore_some_linear;
+
+  shared_terms_only(ldf& d) : all(*d.all), data(d), ignore_constant(all.ignore_linear[constant_namespace]), ignore_some_linear(all.ignore_some_linear)
+  {
+    all.ignore_linear[constant_namespace] = true;
+    all.ignore_some_linear = true;
+    all.interactions.swap(data.shared_interactions);
+  }
+
+  ~shared_terms_only()
+  {
+    all.interactions.swap(data.shared_interactions);
+    all.ignore_linear[constant_namespace] = ignore_constant;
+    all.ignore_some_linear = ignore_some_linear;
+  }
+};
+
+// the score of the shared example alone: its linear terms without the constant, which isn't added to the actions
+float predict_shared(ldf& data, single_learner& base, example& shared)
+{
+  COST_SENSITIVE::label ld = shared.l.cs;
+  polyprediction pred = shared.pred;
+  shared_terms_only only(data);
+
+  shared.l.simple = { FLT_MAX, 1.f, 0.f };
+  uint64_t old_offset = shared.ft_offset;
+  shared.ft_offset = data.ft_offset;
+  base.predict(shared);
+  shared.ft_offset = old_offset;
+  float score = shared.partial_prediction;
+
+  shared.pred = pred;
+  shared.l.cs = ld;
+  return score;
+}
+
+void leave_out_shared_terms(ldf& data, example& shared)
+{
+  vw& all = *data.all;
+  memcpy(data.ignore_linear, all.ignore_linear, sizeof(data.ignore_linear));
+  data.ignore_some_linear = all.ignore_some_linear;
+  for (namespace_index idx : shared.indices)
+    if (idx != constant_namespace && shared.feature_space[idx].nonempty())
+      all.ignore_linear[idx] = true;
+  all.ignore_some_linear = true;
+  all.interactions.swap(data.action_interactions);
+}
+
+void restore_shared_terms(ldf& data)
+{
+  vw& all = *data.all;
+  all.interactions.swap(data.action_interactions);
+  memcpy(all.ignore_linear, data.ignore_linear, sizeof(data.ignore_linear));
+  all.ignore_some_linear = data.ignore_some_linear;
+  data.shared_score = 0.f;
+}
+
+// leaves what predict_shared scored out of the predictions of the actions, until restore or the end of its scope
+struct shared_terms_left_out
+{
+  ldf& data;
+  bool left_out;
+
+  void restore()
+  {
+    if (left_out)
+      restore_shared_terms(data);
+    left_out = false;
+  }
+
+  ~shared_terms_left_out() { restore(); }
+};
+
 bool test_ldf_sequence(ldf& data, size_t start_K, multi_ex& ec_seq)
 {
   bool isTest;
@@ -443,6 +568,13 @@ void do_actual_learning(ldf& data, single_learner& base, multi_ex& ec_seq_all)
   }
   bool isTest = test_ldf_sequence(data, start_K, ec_seq);
   /////////////////////// do prediction
+  shared_terms_left_out shared_terms = { data, false };
+  if (data.shared_once && start_K > 0 && split_shared_terms(data, ec_seq))
+  {
+    data.shared_score = predict_shared(data, base, *ec_seq[0]);
+    leave_out_shared_terms(data, *ec_seq[0]);
+    shared_terms.left_out = true;
+  }
   uint32_t predicted_K = start_K;
   if(data.rank)
   {
@@ -478,6 +610,8 @@ void do_actual_learning(ldf& data, single_learner& base, multi_ex& ec_seq_all)
     }
   }
 
+  shared_terms.restore();
+
   /////////////////////// learn
   if (is_learn && !isTest)
   {
@@ -756,6 +890,8 @@ void finish(ldf& data)
   LabelDict::free_label_features(data.label_features);
   data.a_s.delete_v();
   data.stored_preds.delete_v();
+  data.shared_interactions.~vector<string>();
+  data.action_interactions.~vector<string>();
 }
 
 /*
@@ -816,12 +952,14 @@ base_learner* csldf_setup(arguments& arg)
       .critical<string>("csoaa_ldf", po::value<string>(), "Use one-against-all multiclass learning with label dependent features.")
       ("ldf_override", po::value<string>(), "Override singleline or multiline from csoaa_ldf or wap_ldf, eg if stored in file")
       .keep(ld->rank, "csoaa_rank", "Return actions sorted by score order")
-      .keep(ld->is_probabilities, "probabilities", "predict probabilites of all classes").missing())
+      .keep(ld->is_probabilities, "probabilities", "predict probabilites of all classes")
+      ("ldf_shared_once", "score the features of a shared example once, not with every action (for a base learner that adds up the terms of its features, like gd)").missing())
     if (arg.new_options("").critical<string>("wap_ldf", po::value<string>(), "Use weighted all-pairs multiclass learning with label dependent features.  Specify singleline or multiline.").missing())
       return nullptr;
 
   ld->all = arg.all;
   ld->first_pass = true;
+  ld->shared_once = arg.vm.count("ldf_shared_once") > 0;
 
   string ldf_arg;
 
@@ -877,7 +1015,18 @@ base_learner* csldf_setup(arguments& arg)
     pred_type = prediction_type::multiclass;
 
   ld->read_example_this_loop = 0;
-  learner<ldf,multi_ex>& l = init_learner(ld, as_singleline(setup_base(arg)), do_actual_learning<true>, do_actual_learning<false>, 1, pred_type);
+  single_learner* base = as_singleline(setup_base(arg));
+  if (ld->shared_once)
+  { // the split of an action's score is only exact for a base that adds up the terms of the features
+    vw& all = *arg.all;
+    bool additive = base == all.scorer && all.scorer->get_learn_base()->get_learn_base() == nullptr;
+    for (const char* nonadditive : { "ksvm", "rank", "lda" })
+      if (arg.vm.count(nonadditive) && (arg.vm[nonadditive].value().type() != typeid(bool) || arg.vm[nonadditive].as<bool>()))
+        additive = false;
+    if (!additive)
+      THROW("--ldf_shared_once needs a base learner that adds up the terms of the features, like gd, with no reduction between it and --csoaa_ldf or --wap_ldf");
+  }
+  learner<ldf,multi_ex>& l = init_learner(ld, base, do_actual_learning<true>, do_actual_learning<false>, 1, pred_type);
   l.set_finish_example(finish_multiline_example);
   l.set_finish(finish);
   l.set_end_pass(end_pass);
@@ -0,0 +1,130 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#include <string.h>
+#include "delimiter_scan.h"
+
+#if !defined(VW_NO_INLINE_SIMD) && (defined(__SSE2__) || defined(_M_AMD64) || defined(_M_X64))
+#define DELIMITER_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DELIMITER_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+namespace
+{
+inline bool is_delimiter(char c)
+{
+  return c == ' ' || c == '\t' || c == '|' || c == ':' || c == '\r';
+}
+
+typedef void (*scan_words)(const char* begin, size_t words, uint64_t* mask);
+
+void scan_words_scalar(const char* begin, size_t words, uint64_t* mask)
+{
+  for (size_t w = 0; w < words; w++)
+  {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < 64; i++)
+      bits |= (uint64_t)is_delimiter(begin[w * 64 + i]) << i;
+    mask[w] = bits;
+  }
+}
+
+#ifdef DELIMITER_SSE2
+inline uint64_t sse2_bits(const char* p)
+{
+  __m128i v = _mm_loadu_si128((const __m128i*)p);
+  __m128i d = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                           _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('|')), _mm_cmpeq_epi8(v, _mm_set1_epi8(':'))));
+  d = _mm_or_si128(d, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+  return (uint32_t)_mm_movemask_epi8(d);
+}
+
+void scan_words_sse2(const char* begin, size_t words, uint64_t* mask)
+{
+  for (size_t w = 0; w < words; w++)
+  {
+    const char* p = begin + w * 64;
+    mask[w] = sse2_bits(p) | sse2_bits(p + 16) << 16 | sse2_bits(p + 32) << 32 | sse2_bits(p + 48) << 48;
+  }
+}
+#endif
+
+#ifdef DELIMITER_AVX2
+__attribute__((target("avx2"))) inline uint64_t avx2_bits(const char* p)
+{
+  __m256i v = _mm256_loadu_si256((const __m256i*)p);
+  __m256i d = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                              _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('|')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':'))));
+  d = _mm256_or_si256(d, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+  return (uint32_t)_mm256_movemask_epi8(d);
+}
+
+__attribute__((target("avx2"))) void scan_words_avx2(const char* begin, size_t words, uint64_t* mask)
+{
+  for (size_t w = 0; w < words; w++)
+  {
+    const char* p = begin + w * 64;
+    mask[w] = avx2_bits(p) | avx2_bits(p + 32) << 32;
+  }
+}
+#endif
+
+struct scanner
+{
+  scan_words scan;
+  const char* isa;
+
+  scanner() : scan(scan_words_scalar), isa("scalar")
+  {
+#ifdef DELIMITER_SSE2
+    scan = scan_words_sse2;
+    isa = "sse2";
+#endif
+#ifdef DELIMITER_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+      scan = scan_words_avx2;
+      isa = "avx2";
+    }
+#endif
+  }
+};
+
+const scanner& best_scanner()
+{
+  static scanner s; // picked once, on first use
+  return s;
+}
+
+void find_delimiters(scan_words scan, const char* begin, size_t n, uint64_t* mask)
+{
+  size_t words = n / 64;
+  scan(begin, words, mask);
+  if (n % 64 != 0)
+  { // the tail is padded with bytes that aren't delimiters
+    char tail[64];
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, begin + words * 64, n % 64);
+    scan(tail, 1, mask + words);
+  }
+}
+}
+
+void find_delimiters(const char* begin, size_t n, uint64_t* mask)
+{
+  find_delimiters(best_scanner().scan, begin, n, mask);
+}
+
+void find_delimiters_scalar(const char* begin, size_t n, uint64_t* mask)
+{
+  find_delimiters(scan_words_scalar, begin, n, mask);
+}
+
+const char* delimiter_scan_isa() { return best_scanner().isa; }
@@ -0,0 +1,46 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <intrin.h>
+#endif
+
+/* Bitmasks of the characters that end a name in the text format
+   (' ', '\t', '|', ':' and '\r'), so the text parser can jump from one
+   delimiter to the next instead of testing every byte. */
+
+//the number of mask words covering n bytes
+inline size_t delimiter_words(size_t n) { return (n + 63) / 64; }
+
+//sets bit i % 64 of mask[i / 64] when begin[i] is a delimiter, for i < n; bits past n are cleared.
+//Uses AVX2 or SSE2 when the cpu has them.
+void find_delimiters(const char* begin, size_t n, uint64_t* mask);
+//the same, one byte at a time
+void find_delimiters_scalar(const char* begin, size_t n, uint64_t* mask);
+//the name of the implementation find_delimiters uses
+const char* delimiter_scan_isa();
+
+//the offset of the first delimiter at or after offset < n, or n if there is none
+inline size_t next_delimiter(const uint64_t* mask, size_t offset, size_t n)
+{
+  size_t word = offset / 64;
+  uint64_t bits = mask[word] & (~(uint64_t)0 << (offset % 64));
+  while (bits == 0)
+  {
+    if (++word >= delimiter_words(n))
+      return n;
+    bits = mask[word];
+  }
+#ifdef _WIN32
+  unsigned long bit;
+  _BitScanForward64(&bit, bits);
+#else
+  size_t bit = __builtin_ctzll(bits);
+#endif
+  return word * 64 + bit;
+}
@@ -0,0 +1,264 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#include <stdio.h>
+#include <algorithm>
+#include "delta_checkpoint.h"
+#include "parse_regressor.h"
+#include "floatbits.h"
+#include "vw_exception.h"
+
+using namespace std;
+
+/* A delta is a delta_header, then for each run of consecutive changed pages a
+   delta_run and either the first float of every weight in the run or, when
+   fewer than half are nonzero, a delta_entry for each that is.  Applying an
+   entry list zeroes the rest of the run, as a weight in it may have been
+   zeroed since the last save. */
+const uint64_t delta_magic = 0x31415444454c5756ULL; // "VWDELTA1"
+const size_t page_floats = 1 << 10; // 4KB
+const size_t delta_chunk = 1 << 14; // floats
+const size_t max_run_pages = ((size_t)1 << 31) / page_floats; // so an entry's offset fits 32 bits
+
+struct delta_header
+{
+  uint64_t magic;
+  uint64_t weights;     // 1 << num_bits
+  uint64_t from_digest; // of the weights the delta applies to
+  uint64_t to_digest;   // of the weights after it
+  uint64_t runs;
+};
+
+struct delta_run
+{
+  uint64_t first;   // weight index
+  uint64_t count;
+  uint64_t entries; // count when every weight follows
+};
+
+struct delta_entry
+{
+  uint32_t offset; // from first
+  weight value;
+};
+
+inline uint64_t mix(uint64_t x)
+{
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// a sum of these over the nonzero weights is the same however they are stored or visited
+inline uint64_t weight_digest(uint64_t index, weight w)
+{ return w == 0.f ? 0 : mix(mix(index) ^ float_to_bits(w)); }
+
+// all the floats of a page, learning state included, in four independent lanes
+uint64_t page_checksum(const weight* begin, size_t floats)
+{
+  const uint32_t* x = (const uint32_t*)begin;
+  uint64_t h[4] = { 0xcbf29ce484222325ULL, 1, 2, 3 };
+  size_t j = 0;
+  for (; j + 4 <= floats; j += 4)
+    for (size_t l = 0; l < 4; l++)
+      h[l] = (h[l] ^ x[j + l]) * 0x100000001b3ULL;
+  for (; j < floats; j++)
+    h[0] = (h[0] ^ x[j]) * 0x100000001b3ULL;
+  return mix(h[0] ^ mix(h[1] ^ mix(h[2] ^ mix(h[3]))));
+}
+
+uint64_t page_digest(const weight* begin, size_t floats, uint64_t first_float, uint32_t stride_shift)
+{
+  uint64_t digest = 0;
+  for (size_t j = 0; j < floats; j += (size_t)1 << stride_shift)
+    digest += weight_digest((first_float + j) >> stride_shift, begin[j]);
+  return digest;
+}
+
+void save_delta_checkpoint(vw& all, string file_name)
+{
+  if (file_name == string(""))
+    return;
+  delta_checkpoint& d = *all.deltas;
+  dense_parameters& weights = all.weights.dense_weights;
+  uint32_t stride_shift = weights.stride_shift();
+  uint64_t length = weights.mask() + 1;
+  size_t page = (size_t)min((uint64_t)page_floats, length);
+  size_t pages = (size_t)(length / page);
+
+  if (d.checksums.size() == 0 || find(d.chain.begin(), d.chain.end(), file_name) != d.chain.end())
+  { // a delta is only good next to the model it follows, so one saved over the chain restarts it
+    dump_regressor(all, file_name, false);
+    d.checksums.resize(pages);
+    d.digests.resize(pages);
+    d.digest = 0;
+    for (size_t p = 0; p < pages; p++)
+    {
+      d.checksums[p] = page_checksum(weights.first() + p * page, page);
+      d.digests[p] = page_digest(weights.first() + p * page, page, p * page, stride_shift);
+      d.digest += d.digests[p];
+    }
+    d.chain.clear();
+    d.chain.push_back(file_name);
+    return;
+  }
+
+  vector<size_t> changed;
+  delta_header header = { delta_magic, (uint64_t)1 << all.num_bits, d.digest, d.digest, 0 };
+  for (size_t p = 0; p < pages; p++)
+  {
+    uint64_t checksum = page_checksum(weights.first() + p * page, page);
+    if (checksum == d.checksums[p])
+      continue;
+    if (changed.size() == 0 || changed.back() != p - 1)
+      header.runs++;
+    changed.push_back(p);
+    d.checksums[p] = checksum;
+    header.to_digest -= d.digests[p];
+    d.digests[p] = page_digest(weights.first() + p * page, page, p * page, stride_shift);
+    header.to_digest += d.digests[p];
+  }
+
+  string start_name = file_name + string(".writing");
+  io_buf io_temp;
+  io_temp.open_file(start_name.c_str(), all.stdin_off, io_buf::WRITE);
+  bin_write_fixed(io_temp, (char*)&header, sizeof(header));
+  vector<weight> floats(delta_chunk);
+  vector<delta_entry> entries;
+  for (size_t c = 0; c < changed.size();)
+  {
+    size_t last = c;
+    while (last + 1 < changed.size() && changed[last + 1] == changed[last] + 1 && last + 1 - c < max_run_pages)
+      last++;
+    delta_run run = { (changed[c] * page) >> stride_shift, ((last - c + 1) * page) >> stride_shift, 0 };
+    entries.clear();
+    for (uint64_t j = 0; j < run.count && 2 * entries.size() < run.count; j++)
+      if (weights.strided_index(run.first + j) != 0.f)
+      {
+        delta_entry entry = { (uint32_t)j, weights.strided_index(run.first + j) };
+        entries.push_back(entry);
+      }
+    run.entries = 2 * entries.size() < run.count ? entries.size() : run.count;
+    bin_write_fixed(io_temp, (char*)&run, sizeof(run));
+    if (run.entries < run.count)
+      bin_write_fixed(io_temp, (char*)entries.data(), entries.size() * sizeof(delta_entry));
+    else
+      for (uint64_t done = 0; done < run.count; done += floats.size())
+      {
+        size_t n = (size_t)min((uint64_t)floats.size(), run.count - done);
+        for (size_t j = 0; j < n; j++)
+          floats[j] = weights.strided_index(run.first + done + j);
+        bin_write_fixed(io_temp, (char*)floats.data(), n * sizeof(weight));
+      }
+    c = last + 1;
+  }
+  io_temp.flush();
+  io_temp.close_file();
+
+  remove(file_name.c_str());
+  if (0 != rename(start_name.c_str(), file_name.c_str()))
+    THROW("save_delta_checkpoint: cannot rename: " << start_name << " to " << file_name);
+  d.digest = header.to_digest;
+  d.chain.push_back(file_name);
+  if (!all.quiet)
+    all.opts_n_args.trace_message << "saved " << changed.size() << " of " << pages << " weight pages to the delta " << file_name << endl;
+}
+
+uint64_t weights_digest(dense_parameters& weights)
+{
+  uint64_t digest = 0;
+  for (dense_parameters::iterator w = weights.begin(); w != weights.end(); ++w)
+    digest += weight_digest(w.index() >> weights.stride_shift(), *w);
+  return digest;
+}
+
+inline void set_weight(dense_parameters& weights, uint64_t index, weight value, uint64_t& digest)
+{
+  weight& w = weights.strided_index(index);
+  digest += weight_digest(index, value) - weight_digest(index, w);
+  w = value;
+}
+
+bool is_model_delta(const string& name)
+{
+  FILE* f = fopen(name.c_str(), "rb");
+  if (f == nullptr)
+    return false;
+  uint64_t magic = 0;
+  bool delta = fread(&magic, sizeof(magic), 1, f) == 1 && magic == delta_magic;
+  fclose(f);
+  return delta;
+}
+
+void apply_model_delta(vw& all, const string& name, dense_parameters& weights, uint64_t& digest)
+{
+  io_buf delta;
+  delta.open_file(name.c_str(), all.stdin_off, io_buf::READ);
+  delta_header header;
+  if (bin_read_fixed(delta, (char*)&header, sizeof(header), "") != sizeof(header) || header.magic != delta_magic)
+    THROW(name << " is not a delta from --delta_checkpoints");
+  if (header.weights != (uint64_t)1 << all.num_bits)
+    THROW(name << " is a delta for " << header.weights << " weights, not " << ((uint64_t)1 << all.num_bits));
+  if (header.from_digest != digest)
+    THROW(name << " doesn't follow the model before it, give -i the full model and then its deltas in the order they were saved");
+
+  vector<weight> floats(delta_chunk);
+  vector<delta_entry> entries;
+  for (uint64_t r = 0; r < header.runs; r++)
+  {
+    delta_run run;
+    if (bin_read_fixed(delta, (char*)&run, sizeof(run), "") != sizeof(run) || run.first + run.count > header.weights || run.entries > run.count)
+      THROW(name << " is corrupted, a run of weights is out of range");
+    if (run.entries < run.count)
+    {
+      entries.resize((size_t)run.entries);
+      if (bin_read_fixed(delta, (char*)entries.data(), entries.size() * sizeof(delta_entry), "") != entries.size() * sizeof(delta_entry))
+        THROW(name << " is corrupted, it ends in a run of weights");
+      for (uint64_t j = 0; j < run.count; j++)
+        set_weight(weights, run.first + j, 0.f, digest);
+      for (size_t e = 0; e < entries.size(); e++)
+      {
+        if (entries[e].offset >= run.count)
+          THROW(name << " is corrupted, a weight is outside its run");
+        set_weight(weights, run.first + entries[e].offset, entries[e].value, digest);
+      }
+      continue;
+    }
+    for (uint64_t done = 0; done < run.count; done += floats.size())
+    {
+      size_t n = (size_t)min((uint64_t)floats.size(), run.count - done);
+      if (bin_read_fixed(delta, (char*)floats.data(), n * sizeof(weight), "") != n * sizeof(weight))
+        THROW(name << " is corrupted, it ends in a run of weights");
+      for (size_t j = 0; j < n; j++)
+        set_weight(weights, run.first + done + j, floats[j], digest);
+    }
+  }
+  delta.close_file();
+  if (digest != header.to_digest)
+    THROW(name << " is corrupted, the weights it leaves don't match its digest");
+}
+
+void apply_model_deltas(vw& all)
+{
+  po::variables_map& vm = all.opts_n_args.vm;
+  if (!vm.count("initial_regressor") || vm["initial_regressor"].as<vector<string>>().size() < 2)
+    return;
+
+  const vector<string>& regs = vm["initial_regressor"].as<vector<string>>();
+  vector<string> deltas;
+  for (size_t i = 1; i < regs.size(); i++)
+    if (is_model_delta(regs[i])) // parse_regressor_args warned about the others, which are ignored
+      deltas.push_back(regs[i]);
+  if (deltas.empty())
+    return;
+  if (all.weights.sparse || all.weights.serving_bits != 0)
+    THROW("deltas from --delta_checkpoints apply to dense float weights, not --sparse_weights or a model from --export_serving_model");
+
+  uint64_t digest = weights_digest(all.weights.dense_weights);
+  for (string& delta : deltas)
+    apply_model_delta(all, delta, all.weights.dense_weights, digest);
+  if (!all.quiet)
+    all.opts_n_args.trace_message << "applied " << deltas.size() << " model deltas" << endl;
+}
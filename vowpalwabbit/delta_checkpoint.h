@@ -0,0 +1,32 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "global_data.h"
+
+/* --delta_checkpoints: the first model saved per pass or by a save command is
+   a full model, every later one a delta holding only the weights on pages of
+   the dense array that changed since the save before it.  Pages are found
+   changed by comparing a checksum of each against the one taken at the last
+   save, which costs a read of the array but nothing while learning.  A delta
+   carries a digest of the weights it applies to and of the weights after it,
+   so vw -i base -i delta1 -i delta2 ... refuses a chain out of order. */
+struct delta_checkpoint
+{
+  std::vector<uint64_t> checksums; // of each page at the last save
+  std::vector<uint64_t> digests;   // what the weights of each page add to digest
+  uint64_t digest;                 // of the weights published by the last save
+  std::vector<std::string> chain;  // files written since the last full model, which a delta must not replace
+};
+
+//writes the model to file_name, in full the first time and as a delta after that
+void save_delta_checkpoint(vw& all, std::string file_name);
+//whether the file starts with the header of a delta from --delta_checkpoints
+bool is_model_delta(const std::string& name);
+//applies the deltas among the second and later -i files, in order, to the weights loaded from the first
+void apply_model_deltas(vw& all);
@@ -0,0 +1,258 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#include <float.h>
+#include "dense_kernels.h"
+
+#if !defined(VW_NO_INLINE_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DENSE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace
+{
+typedef size_t (*dot_kernel)(const float* w, uint64_t step, const float* x, size_t n, float& dot);
+typedef size_t (*axpy_kernel)(float* w, uint64_t step, const float* x, size_t n, float update, size_t spare, bool skip_zero);
+typedef size_t (*norm_kernel)(float* w, uint64_t step, const float* x, size_t n, strided_norm& nd);
+
+size_t dot_none(const float*, uint64_t, const float*, size_t, float&) { return 0; }
+size_t axpy_none(float*, uint64_t, const float*, size_t, float, size_t, bool) { return 0; }
+size_t pred_per_update_none(float*, uint64_t, const float*, size_t, strided_norm&) { return 0; }
+
+#ifdef DENSE_AVX2
+#define AVX2_FMA __attribute__((target("avx2,fma")))
+
+// the offsets of 8 weights step apart fit the 32 bits of a gather
+inline bool gatherable(uint64_t step) { return step < ((uint64_t)1 << 28); }
+
+AVX2_FMA inline __m256i lane_offsets(uint64_t step)
+{
+  return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)step));
+}
+
+AVX2_FMA inline __m256 load_lanes(const float* w, uint64_t step, __m256i offsets)
+{
+  return step == 1 ? _mm256_loadu_ps(w) : _mm256_i32gather_ps(w, offsets, 4);
+}
+
+AVX2_FMA inline void store_lanes(float* w, uint64_t step, __m256 v)
+{
+  if (step == 1)
+  {
+    _mm256_storeu_ps(w, v);
+    return;
+  }
+  float lane[8]; // there is no scatter before AVX-512
+  _mm256_storeu_ps(lane, v);
+  for (size_t l = 0; l < 8; l++)
+    w[l * step] = lane[l];
+}
+
+// the 4 x 4 transpose of each 128 bit half of r
+AVX2_FMA inline void transpose(const __m256 r[4], __m256 t[4])
+{
+  __m256 lo01 = _mm256_unpacklo_ps(r[0], r[1]);
+  __m256 lo23 = _mm256_unpacklo_ps(r[2], r[3]);
+  __m256 hi01 = _mm256_unpackhi_ps(r[0], r[1]);
+  __m256 hi23 = _mm256_unpackhi_ps(r[2], r[3]);
+  t[0] = _mm256_shuffle_ps(lo01, lo23, 0x44);
+  t[1] = _mm256_shuffle_ps(lo01, lo23, 0xee);
+  t[2] = _mm256_shuffle_ps(hi01, hi23, 0x44);
+  t[3] = _mm256_shuffle_ps(hi01, hi23, 0xee);
+}
+
+// the first 4 floats of 8 weights step >= 4 apart, which hold the weight and its learning
+// state, as a vector of each float: b[0] the weights, b[adaptive] their adaptive sums and so on
+AVX2_FMA inline void load_blocks(const float* w, uint64_t step, __m256 b[4])
+{
+  __m256 r[4];
+  for (size_t j = 0; j < 4; j++)
+    r[j] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(w + j * step)), _mm_loadu_ps(w + (j + 4) * step), 1);
+  transpose(r, b);
+}
+
+AVX2_FMA inline void store_blocks(float* w, uint64_t step, const __m256 b[4])
+{
+  __m256 r[4];
+  transpose(b, r);
+  for (size_t j = 0; j < 4; j++)
+  {
+    _mm_storeu_ps(w + j * step, _mm256_castps256_ps128(r[j]));
+    _mm_storeu_ps(w + (j + 4) * step, _mm256_extractf128_ps(r[j], 1));
+  }
+}
+
+AVX2_FMA inline float horizontal_sum(__m256 v)
+{
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+
+// the lanes of w that are not 0, as gd leaves the weights a feature mask zeroed alone
+AVX2_FMA inline __m256 nonzero_lanes(__m256 w, bool skip_zero)
+{
+  return skip_zero ? _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_NEQ_UQ) : _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+}
+
+AVX2_FMA size_t dot_avx2(const float* w, uint64_t step, const float* x, size_t n, float& dot)
+{
+  if (!gatherable(step))
+    return 0;
+  const __m256i offsets = lane_offsets(step);
+  __m256 sum0 = _mm256_setzero_ps();
+  __m256 sum1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), load_lanes(w + i * step, step, offsets), sum0);
+    sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), load_lanes(w + (i + 8) * step, step, offsets), sum1);
+  }
+  for (; i + 8 <= n; i += 8)
+    sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), load_lanes(w + i * step, step, offsets), sum0);
+  dot += horizontal_sum(_mm256_add_ps(sum0, sum1));
+  return i;
+}
+
+AVX2_FMA size_t axpy_avx2(float* w, uint64_t step, const float* x, size_t n, float update, size_t spare, bool skip_zero)
+{
+  const __m256 u = _mm256_set1_ps(update);
+  size_t i = 0;
+  if (spare != 0)
+  {
+    if (spare >= 4 || step < 4)
+      return 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      __m256 b[4];
+      load_blocks(w + i * step, step, b);
+      __m256 xi = _mm256_mul_ps(_mm256_loadu_ps(x + i), b[spare]);
+      b[0] = _mm256_blendv_ps(b[0], _mm256_fmadd_ps(u, xi, b[0]), nonzero_lanes(b[0], skip_zero));
+      store_blocks(w + i * step, step, b);
+    }
+    return i;
+  }
+  if (!gatherable(step))
+    return 0;
+  const __m256i offsets = lane_offsets(step);
+  for (; i + 8 <= n; i += 8)
+  {
+    float* wi = w + i * step;
+    __m256 w0 = load_lanes(wi, step, offsets);
+    store_lanes(wi, step, _mm256_blendv_ps(w0, _mm256_fmadd_ps(u, _mm256_loadu_ps(x + i), w0), nonzero_lanes(w0, skip_zero)));
+  }
+  return i;
+}
+
+AVX2_FMA size_t pred_per_update_avx2(float* w, uint64_t step, const float* x, size_t n, strided_norm& nd)
+{
+  if (nd.spare == 0 || nd.spare >= 4 || step < 4)
+    return 0;
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.f);
+  const __m256 sign_bit = _mm256_set1_ps(-0.f);
+  const __m256 x_min = _mm256_set1_ps(nd.x_min);
+  const __m256 x2_min = _mm256_set1_ps(nd.x_min * nd.x_min);
+  const __m256 x2_max = _mm256_set1_ps(FLT_MAX);
+  const __m256 grad_squared = _mm256_set1_ps(nd.grad_squared);
+  __m256 pred_per_update = zero;
+  __m256 norm_x = zero;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    float* wi = w + i * step;
+    __m256 xi = _mm256_loadu_ps(x + i);
+    __m256 x2 = _mm256_mul_ps(xi, xi);
+    __m256 small = _mm256_cmp_ps(x2, x2_min, _CMP_LT_OQ);
+    __m256 signed_min = _mm256_blendv_ps(_mm256_xor_ps(x_min, sign_bit), x_min, _mm256_cmp_ps(xi, zero, _CMP_GT_OQ));
+    xi = _mm256_blendv_ps(xi, signed_min, small);
+    x2 = _mm256_blendv_ps(x2, x2_min, small);
+    if (_mm256_movemask_ps(_mm256_cmp_ps(x2, x2_max, _CMP_GT_OQ)) != 0)
+      break;
+
+    __m256 b[4];
+    load_blocks(wi, step, b);
+    __m256 w0 = b[0];
+    __m256 active = nonzero_lanes(w0, nd.skip_zero);
+    __m256 rate_decay = one;
+    if (nd.adaptive)
+    {
+      __m256 wa = _mm256_fmadd_ps(grad_squared, x2, b[nd.adaptive]);
+      b[nd.adaptive] = _mm256_blendv_ps(b[nd.adaptive], wa, active);
+      rate_decay = _mm256_rsqrt_ps(wa);
+    }
+    if (nd.normalized)
+    {
+      __m256 old = b[nd.normalized];
+      __m256 x_abs = _mm256_andnot_ps(sign_bit, xi);
+      __m256 new_scale = _mm256_cmp_ps(x_abs, old, _CMP_GT_OQ);
+      // rescale the weight so it's as if the new scale was the old scale
+      __m256 rescale = _mm256_div_ps(old, x_abs);
+      if (!nd.adaptive)
+        rescale = _mm256_mul_ps(rescale, rescale);
+      __m256 rescaled = _mm256_and_ps(active, _mm256_and_ps(new_scale, _mm256_cmp_ps(old, zero, _CMP_GT_OQ)));
+      b[0] = _mm256_blendv_ps(w0, _mm256_mul_ps(w0, rescale), rescaled);
+      __m256 wn = _mm256_blendv_ps(old, x_abs, new_scale);
+      b[nd.normalized] = _mm256_blendv_ps(old, wn, active);
+      norm_x = _mm256_add_ps(norm_x, _mm256_and_ps(active, _mm256_div_ps(x2, _mm256_mul_ps(wn, wn))));
+      __m256 inv_norm = _mm256_div_ps(one, wn);
+      rate_decay = _mm256_mul_ps(rate_decay, nd.adaptive ? inv_norm : _mm256_mul_ps(inv_norm, inv_norm));
+    }
+    b[nd.spare] = _mm256_blendv_ps(b[nd.spare], rate_decay, active);
+    store_blocks(wi, step, b);
+    pred_per_update = _mm256_add_ps(pred_per_update, _mm256_and_ps(active, _mm256_mul_ps(x2, rate_decay)));
+  }
+  nd.pred_per_update += horizontal_sum(pred_per_update);
+  nd.norm_x += horizontal_sum(norm_x);
+  return i;
+}
+#endif
+
+struct kernels
+{
+  dot_kernel dot;
+  axpy_kernel axpy;
+  norm_kernel pred_per_update;
+  const char* isa;
+
+  kernels() : dot(dot_none), axpy(axpy_none), pred_per_update(pred_per_update_none), isa("scalar")
+  {
+#ifdef DENSE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+      dot = dot_avx2;
+      axpy = axpy_avx2;
+      pred_per_update = pred_per_update_avx2;
+      isa = "avx2";
+    }
+#endif
+  }
+};
+
+const kernels& best_kernels()
+{
+  static kernels k; // picked once, on first use
+  return k;
+}
+}
+
+size_t strided_dot(const float* w, uint64_t step, const float* x, size_t n, float& dot)
+{
+  return best_kernels().dot(w, step, x, n, dot);
+}
+
+size_t strided_axpy(float* w, uint64_t step, const float* x, size_t n, float update, size_t spare, bool skip_zero)
+{
+  return best_kernels().axpy(w, step, x, n, update, spare, skip_zero);
+}
+
+size_t strided_pred_per_update(float* w, uint64_t step, const float* x, size_t n, strided_norm& nd)
+{
+  return best_kernels().pred_per_update(w, step, x, n, nd);
+}
+
+const char* dense_kernel_isa() { return best_kernels().isa; }
@@ -0,0 +1,42 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kernels for a dense namespace (see features::dense_step): n feature values
+   x whose weights are w[0], w[step], w[2 * step], ... in the dense weight
+   array.  They use AVX2 and FMA when the cpu has them, eight features at a
+   time, and return how many of the leading features they handled, so the
+   caller finishes the rest (all of them without AVX2) one feature at a time. */
+
+//the fewest features the parser marks dense
+const size_t dense_min_features = 8;
+
+//adds the sum of x[i] * w[i * step] to dot
+size_t strided_dot(const float* w, uint64_t step, const float* x, size_t n, float& dot);
+
+//w[i * step] += update * x[i] * w[i * step + spare], leaving out w[i * step + spare] when spare is 0
+//and the weights that are 0 when skip_zero
+size_t strided_axpy(float* w, uint64_t step, const float* x, size_t n, float update, size_t spare, bool skip_zero);
+
+//what gd's pred_per_update_feature does with a learning rate power of 0.5 and the state in floats
+struct strided_norm
+{
+  float grad_squared;
+  float x_min;   // magnitudes below are taken to be x_min
+  size_t adaptive;
+  size_t normalized;
+  size_t spare;
+  bool skip_zero;
+  float pred_per_update; // added to
+  float norm_x;          // added to
+};
+//stops early at a feature too large to square, which the caller throws on
+size_t strided_pred_per_update(float* w, uint64_t step, const float* x, size_t n, strided_norm& nd);
+
+//the name of the instruction set the kernels use
+const char* dense_kernel_isa();
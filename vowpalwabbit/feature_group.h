@@ -98,6 +98,9 @@ public:
   bool operator==(const features_value_iterator& rhs) { return _begin == rhs._begin; }
   bool operator!=(const features_value_iterator& rhs) { return _begin != rhs._begin; }
 
+  /// \return number of features from \p rhs to this iterator
+  ptrdiff_t operator-(const features_value_iterator& rhs) const { return _begin - rhs._begin; }
+
   friend void swap(features_value_iterator& lhs, features_value_iterator& rhs) { std::swap(lhs._begin, rhs._begin); }
 
   friend struct features;
@@ -225,6 +228,9 @@ struct features
   v_array<audit_strings_ptr> space_names; //Optional for audit mode.
 
   float sum_feat_sq;
+  // indicies[i] == indicies[0] + i * dense_step for every feature, or 0.  The parser sets it for a
+  // namespace of consecutive numeric feature names, so a learner can read its weights as one strided block.
+  uint64_t dense_step;
 
   typedef features_value_index_iterator iterator;
   typedef features_value_iterator iterator_value;
@@ -248,6 +254,7 @@ struct features
     indicies = v_init<feature_index>();
     space_names = v_init<audit_strings_ptr>();
     sum_feat_sq = 0.f;
+    dense_step = 0;
   }
 
   // if one wants to add proper destructor for features, make sure to update ezexample_predict::~ezexample_predict();
@@ -273,6 +280,7 @@ struct features
 
   void clear()
   { sum_feat_sq = 0.f;
+    dense_step = 0;
     values.clear();
     indicies.clear();
     space_names.clear();
@@ -280,6 +288,7 @@ struct features
 
   void truncate_to(const features_value_iterator& pos)
   { ssize_t i = pos._begin - values.begin();
+    dense_step = 0;
     values.end() = pos._begin;
     if (indicies.end() != indicies.begin())
       indicies.end() = indicies.begin() + i;
@@ -290,7 +299,8 @@ struct features
   }
 
   void truncate_to(size_t i)
-  { values.end() = values.begin() + i;
+  { dense_step = 0;
+    values.end() = values.begin() + i;
     if (indicies.end() != indicies.begin())
       indicies.end() = indicies.begin() + i;
     if (space_names.begin() != space_names.end())
@@ -300,7 +310,8 @@ struct features
   }
 
   void delete_v()
-  { values.delete_v();
+  { dense_step = 0;
+    values.delete_v();
     indicies.delete_v();
     space_names.delete_v();
   }
@@ -309,10 +320,23 @@ struct features
   { values.push_back(v);
     indicies.push_back(i);
     sum_feat_sq += v*v;
+    dense_step = 0;
+  }
+
+  // sets dense_step to step if there are at least min_features and their indicies are that far apart
+  void find_dense(uint64_t step, size_t min_features)
+  { dense_step = 0;
+    if (indicies.size() < min_features || indicies.size() != values.size() || step == 0)
+      return;
+    for (size_t i = 1; i < indicies.size(); i++)
+      if (indicies[i] != indicies[i - 1] + step)
+        return;
+    dense_step = step;
   }
 
   bool sort(uint64_t parse_mask)
-  { if (indicies.size() == 0)
+  { dense_step = 0;
+    if (indicies.size() == 0)
       return false;
 
     if (space_names.size() != 0)
@@ -350,5 +374,6 @@ struct features
     copy_array(indicies, src.indicies);
     copy_array_no_memcpy(space_names, src.space_names);
     sum_feat_sq = src.sum_feat_sq;
+    dense_step = src.dense_step;
   }
 };
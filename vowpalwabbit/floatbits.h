@@ -17,3 +17,18 @@ static inline float bits_to_float(uint32_t a)
   x.i = a;
   return x.f;
 }
+
+// bfloat16 is the upper half of a float: the same exponent range with 8 bits of precision
+static inline float bfloat16_to_float(uint16_t a)
+{ return bits_to_float((uint32_t)a << 16);
+}
+
+// rounds a non-negative float up, so a stored maximum is never below the value it records
+static inline uint16_t float_to_bfloat16_up(float a)
+{ return (uint16_t)((float_to_bits(a) + 0xffff) >> 16);
+}
+
+// rounds up with the probability of the dropped bits exceeding dither, so small increments add up on average
+static inline uint16_t float_to_bfloat16_dithered(float a, uint16_t dither)
+{ return (uint16_t)((float_to_bits(a) + dither) >> 16);
+}
@@ -6,6 +6,8 @@ license as described in the file LICENSE.
 #include "crossplat_compat.h"
 
 #include <float.h>
+#include <thread>
+#include <atomic>
 #ifdef _WIN32
 #include <WinSock2.h>
 #else
@@ -25,6 +27,8 @@ license as described in the file LICENSE.
 #include "reductions.h"
 #include "vw.h"
 #include "floatbits.h"
+#include "vw_versions.h"
+#include "dense_kernels.h"
 
 #define VERSION_SAVE_RESUME_FIX "7.10.1"
 #define VERSION_PASS_UINT64 "8.3.3"
@@ -35,25 +39,39 @@ using namespace LEARNER;
 //4. Factor various state out of vw&
 namespace GD
 {
+// a -q interaction, with whether its features are combined rather than permuted as those of a namespace with itself
+struct namespace_pair
+{
+  namespace_index first;
+  namespace_index second;
+  bool same;
+};
+
 struct gd
 {
   //double normalized_sum_norm_x;
-  double total_weight;
+  atomic<double> total_weight; // added to by every --threads learner, as all.normalized_sum_norm_x
   size_t no_win_counter;
   size_t early_stop_thres;
   float initial_constant;
   float neg_norm_power;
   float neg_power_t;
   float sparse_l2;
-  float update_multiplier;
+  uint32_t dither; // --half_state: seeds the rounding of the adaptive sums of each example
   void (*predict)(gd&, base_learner&, example&);
   void (*learn)(gd&, base_learner&, example&);
   void (*update)(gd&, base_learner&, example&);
   float (*sensitivity)(gd&, base_learner&, example&);
   void (*multipredict)(gd&, base_learner&, example&, size_t, size_t, polyprediction*, bool);
+  void (*predict_batch)(gd&, base_learner&, example**, size_t);
   bool normalized;
   bool adaptive;
   bool adax;
+  bool half_state;
+  bool cache_interactions;   // --interaction_cache
+  bool interactions_cached;  // interactions holds those of the example being learned
+  features interactions;     // with ft_offset added to the indices
+  v_array<namespace_pair> pairs; // the interactions, when predict_only scores them
 
   vw* all; //parallel, features, parameters
 };
@@ -99,6 +117,85 @@ static inline float InvSqrt(float x)
   return x;
 }
 
+inline void push_interaction(features& fs, float x, uint64_t index) { fs.push_back(x, index); }
+
+// generates the interaction features of ec into g.interactions, for learn to hand to predict and update
+void cache_interactions(gd& g, example& ec)
+{
+  vw& all = *g.all;
+  g.interactions.clear();
+  if (all.weights.sparse)
+    generate_interactions<features, uint64_t, push_interaction, sparse_parameters>(all.interactions, all.permutations, ec, g.interactions, all.weights.sparse_weights);
+  else
+    generate_interactions<features, uint64_t, push_interaction, dense_parameters>(all.interactions, all.permutations, ec, g.interactions, all.weights.dense_weights);
+  g.interactions_cached = true;
+}
+
+// ends what cache_interactions started however learn returns, as update throws on features of too much magnitude
+struct uncache_interactions
+{
+  gd& g;
+  ~uncache_interactions() { g.interactions_cached = false; }
+};
+
+// iterate through the interaction features of an example, read from g.interactions while learn holds them there
+template <class R, class S, void(*T)(R&, float, S), class W>
+inline void foreach_interaction(gd& g, example& ec, R& dat, W& weights)
+{
+  if (g.interactions_cached)
+    foreach_feature<R, T, W>(weights, g.interactions, dat);
+  else
+    generate_interactions<R, S, T, W>(g.all->interactions, g.all->permutations, ec, dat, weights);
+}
+
+template <class R, class S, void(*T)(R&, float, S), class W>
+inline void foreach_feature(gd& g, W& weights, example& ec, R& dat)
+{
+  vw& all = *g.all;
+  for (example_predict::iterator i = ec.begin(); i != ec.end(); ++i)
+    if (!all.ignore_some_linear || !all.ignore_linear[i.index()])
+      foreach_feature<R, T, W>(weights, *i, dat, ec.ft_offset);
+  foreach_interaction<R, S, T, W>(g, ec, dat, weights);
+}
+
+// iterate through all the features of an example like foreach_feature, with those of its interactions from foreach_interaction
+template <class R, class S, void(*T)(R&, float, S)>
+inline void foreach_feature(gd& g, example& ec, R& dat)
+{
+  if (g.all->weights.sparse)
+    foreach_feature<R, S, T, sparse_parameters>(g, g.all->weights.sparse_weights, ec, dat);
+  else
+    foreach_feature<R, S, T, dense_parameters>(g, g.all->weights.dense_weights, ec, dat);
+}
+
+// iterate through the features of an example like foreach_feature, but hand each dense namespace
+// (see features::dense_step) whose weights don't wrap around the dense array to D in one call,
+// callback function D(some_data_R, first_feature_weight, weight_step, feature_values, count)
+template <class R, class S, void(*T)(R&, float, S), void(*D)(R&, weight*, uint64_t, const float*, size_t)>
+inline void foreach_dense_feature(gd& g, example& ec, R& dat)
+{
+  vw& all = *g.all;
+  dense_parameters& weights = all.weights.dense_weights;
+  uint64_t offset = ec.ft_offset;
+  for (example_predict::iterator i = ec.begin(); i != ec.end(); ++i)
+  {
+    if (all.ignore_some_linear && all.ignore_linear[i.index()])
+      continue;
+    features& fs = *i;
+    if (fs.dense_step != 0)
+    {
+      uint64_t first = (fs.indicies[0] + offset) & weights.mask();
+      if (first + (fs.size() - 1) * fs.dense_step <= weights.mask())
+      {
+        D(dat, weights.first() + first, fs.dense_step, fs.values.begin(), fs.size());
+        continue;
+      }
+    }
+    foreach_feature<R, T, dense_parameters>(weights, fs, dat, offset);
+  }
+  foreach_interaction<R, S, T, dense_parameters>(g, ec, dat, weights);
+}
+
 template<bool sqrt_rate, bool feature_mask_off, size_t adaptive, size_t normalized, size_t spare>
 inline void update_feature(float& update, float x, float& fw)
 {
@@ -111,6 +208,13 @@ inline void update_feature(float& update, float x, float& fw)
   }
 }
 
+template<bool sqrt_rate, bool feature_mask_off, size_t adaptive, size_t normalized, size_t spare>
+void update_dense(float& update, weight* w, uint64_t step, const float* x, size_t n)
+{
+  for (size_t i = strided_axpy(w, step, x, n, update, spare, !feature_mask_off); i < n; i++)
+    update_feature<sqrt_rate, feature_mask_off, adaptive, normalized, spare>(update, x[i], w[i * step]);
+}
+
 //this deals with few nonzero features vs. all nonzero features issues.
 template<bool sqrt_rate, size_t adaptive, size_t normalized>
 float average_update(float total_weight, float normalized_sum_norm_x, float neg_norm_power)
@@ -132,11 +236,15 @@ float average_update(float total_weight, float normalized_sum_norm_x, float neg_
 }
 
 template<bool sqrt_rate, bool feature_mask_off, size_t adaptive, size_t normalized, size_t spare>
-void train(gd& g, example& ec, float update)
+void train(gd& g, example& ec, float update, float update_multiplier)
 {
   if (normalized)
-    update *= g.update_multiplier;
-  foreach_feature<float, update_feature<sqrt_rate, feature_mask_off, adaptive, normalized, spare> >(*g.all, ec, update);
+    update *= update_multiplier;
+  if (g.all->weights.sparse)
+    foreach_feature<float, float&, update_feature<sqrt_rate, feature_mask_off, adaptive, normalized, spare> >(g, ec, update);
+  else
+    foreach_dense_feature<float, float&, update_feature<sqrt_rate, feature_mask_off, adaptive, normalized, spare>,
+                          update_dense<sqrt_rate, feature_mask_off, adaptive, normalized, spare> >(g, ec, update);
 }
 
 void end_pass(gd& g)
@@ -247,7 +355,7 @@ inline void audit_feature(audit_results& dat, const float ft_weight, const uint6
                << ':' << trunc_weight(weights[index], (float)dat.all.sd->gravity) * (float)dat.all.sd->contraction;
 
     if (dat.all.adaptive)
-      tempstream << '@' << (&weights[index])[1];
+      tempstream << '@' << (dat.all.half_state ? half_adaptive(&weights[index]) : (&weights[index])[1]);
 
 
     string_value sv = { weights[index] * ft_weight, ns_pre + tempstream.str() };
@@ -360,13 +468,26 @@ inline void vec_add_trunc(trunc_data& p, const float fx, float& fw)
   p.prediction += trunc_weight(fw, p.gravity) * fx;
 }
 
-inline float trunc_predict(vw& all, example& ec, double gravity)
+inline float trunc_predict(gd& g, example& ec, double gravity)
 {
   trunc_data temp = {ec.l.simple.initial, (float)gravity};
-  foreach_feature<trunc_data, vec_add_trunc>(all, ec, temp);
+  foreach_feature<trunc_data, float&, vec_add_trunc>(g, ec, temp);
   return temp.prediction;
 }
 
+inline void vec_add_dense(float& p, weight* w, uint64_t step, const float* x, size_t n)
+{
+  for (size_t i = strided_dot(w, step, x, n, p); i < n; i++)
+    p += w[i * step] * x[i];
+}
+
+inline float dense_predict(gd& g, example& ec)
+{
+  float prediction = ec.l.simple.initial;
+  foreach_dense_feature<float, const float&, vec_add, vec_add_dense>(g, ec, prediction);
+  return prediction;
+}
+
 inline void vec_add_print(float&p, const float fx, float& fw)
 {
   p += fw * fx;
@@ -377,8 +498,15 @@ template<bool l1, bool audit>
 void predict(gd& g, base_learner&, example& ec)
 {
   vw& all = *g.all;
-  if (l1)
-    ec.partial_prediction = trunc_predict(all, ec, all.sd->gravity);
+  if (l1 && all.weights.serving_bits == 0)
+    ec.partial_prediction = trunc_predict(g, ec, all.sd->gravity);
+  else if (all.weights.serving_bits == 0 && !all.weights.sparse)
+    ec.partial_prediction = dense_predict(g, ec);
+  else if (g.interactions_cached)
+  {
+    ec.partial_prediction = ec.l.simple.initial;
+    foreach_feature<float, const float&, vec_add>(g, ec, ec.partial_prediction);
+  }
   else
     ec.partial_prediction = inline_predict(all, ec);
 
@@ -388,6 +516,151 @@ void predict(gd& g, base_learner&, example& ec)
     print_audit_features(all, ec);
 }
 
+// the linear terms of a namespace, a dense one in a call to the strided kernel as dense_predict does
+template <class W>
+inline void add_linear(W& weights, features& fs, uint64_t offset, float& p)
+{ foreach_feature<float, vec_add, W>(weights, fs, p, offset); }
+
+inline void add_linear(dense_parameters& weights, features& fs, uint64_t offset, float& p)
+{
+  if (fs.dense_step != 0)
+  {
+    uint64_t first = (fs.indicies[0] + offset) & weights.mask();
+    if (first + (fs.size() - 1) * fs.dense_step <= weights.mask())
+    {
+      vec_add_dense(p, weights.first() + first, fs.dense_step, fs.values.begin(), fs.size());
+      return;
+    }
+  }
+  foreach_feature<float, vec_add, dense_parameters>(weights, fs, p, offset);
+}
+
+/* The prediction of predict<false, false> for a vw that only predicts, with
+   what a loaded model and the options settle decided once in setup rather
+   than for each example: no --audit or --l1, not sparse weights, and no
+   interactions (pairs false) or only pairs, which g.pairs lists.  It adds up
+   the same terms in the same order. */
+template <class W, bool pairs>
+inline float predict_only(gd& g, W& weights, example& ec)
+{
+  float p = ec.l.simple.initial;
+  const uint64_t offset = ec.ft_offset;
+  for (features& fs : ec)
+    add_linear(weights, fs, offset, p);
+  const size_t distance = weights.prefetch_distance();
+  if (pairs)
+    for (namespace_pair& ns : g.pairs)
+    {
+      features& first = ec.feature_space[ns.first];
+      features& second = ec.feature_space[ns.second];
+      const size_t n = second.size();
+      for (size_t i = 0; i < first.size(); ++i)
+      {
+        const uint64_t halfhash = FNV_prime * (uint64_t)first.indicies[i];
+        const float x = first.values[i];
+        size_t j = ns.same ? i : 0;
+        if (distance > 0 && n - j > distance)
+        { // long enough to look ahead in, as generate_interactions does
+          features::iterator_all begin = second.values_indices_audit().begin() + j;
+          features::iterator_all end = second.values_indices_audit().end();
+          INTERACTIONS::inner_kernel<float, const float&, vec_add, false, dummy_func<float>, W>(p, begin, end, offset, weights, x, halfhash);
+          continue;
+        }
+        for (; j < n; ++j)
+          p += weights[(second.indicies[j] ^ halfhash) + offset] * INTERACTIONS::INTERACTION_VALUE(x, second.values[j]);
+      }
+    }
+  return p;
+}
+
+template <bool pairs>
+inline float predict_only(gd& g, example& ec)
+{
+  vw& all = *g.all;
+  if (all.weights.serving_bits == 8)
+    return predict_only<int8_parameters, pairs>(g, all.weights.int8_weights, ec);
+  else if (all.weights.serving_bits == 16)
+    return predict_only<fp16_parameters, pairs>(g, all.weights.fp16_weights, ec);
+  else
+    return predict_only<dense_parameters, pairs>(g, all.weights.dense_weights, ec);
+}
+
+// whether g.pairs lists all.interactions, which reductions above gd may change
+// after setup (search tasks) or for each example (--ldf_shared_once)
+inline bool pairs_current(vw& all, gd& g)
+{
+  if (all.interactions.size() != g.pairs.size())
+    return false;
+  for (size_t i = 0; i < g.pairs.size(); i++)
+  {
+    string& ns = all.interactions[i];
+    if (ns.size() != 2 || (namespace_index)ns[0] != g.pairs[i].first || (namespace_index)ns[1] != g.pairs[i].second)
+      return false;
+  }
+  return true;
+}
+
+// sets g.pairs to all.interactions, false when they are not all pairs
+bool set_pairs(vw& all, gd& g)
+{
+  g.pairs.clear();
+  for (string& ns : all.interactions)
+    if (ns.size() != 2)
+      return false;
+  for (string& ns : all.interactions)
+  {
+    namespace_pair pair = { (namespace_index)ns[0], (namespace_index)ns[1], !all.permutations && ns[0] == ns[1] };
+    g.pairs.push_back(pair);
+  }
+  return true;
+}
+
+void predict_only(gd& g, base_learner& base, example& ec)
+{
+  vw& all = *g.all;
+  if (all.ignore_some_linear || (!pairs_current(all, g) && !set_pairs(all, g)))
+  {
+    predict<false, false>(g, base, ec);
+    return;
+  }
+  if (g.pairs.size() > 0)
+    ec.partial_prediction = predict_only<true>(g, ec);
+  else
+    ec.partial_prediction = predict_only<false>(g, ec);
+  ec.partial_prediction *= (float)all.sd->contraction;
+  ec.pred.scalar = finalize_prediction(all.sd, ec.partial_prediction);
+}
+
+void predict_only_batch(gd& g, base_learner& base, example** ecs, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (i + 1 < count)
+      prefetch_weights(*g.all, *ecs[i + 1]);
+    predict_only(g, base, *ecs[i]);
+  }
+}
+
+/* whether predict_only can stand in for predict<false, false>: the options it
+   does not handle are fixed once the model loads, while the interactions and
+   ignored namespaces it checks for each example */
+bool set_predict_only(vw& all)
+{
+  return !(all.training || all.audit || all.hash_inv || all.reg_mode % 2 || all.weights.sparse);
+}
+
+template<bool l1, bool audit>
+void predict_batch(gd& g, base_learner& base, example** ecs, size_t count)
+{
+  vw& all = *g.all;
+  for (size_t i = 0; i < count; i++)
+  {
+    if (i + 1 < count)
+      prefetch_weights(all, *ecs[i + 1]);
+    predict<l1, audit>(g, base, *ecs[i]);
+  }
+}
+
 template <class T> inline void vec_add_trunc_multipredict(multipredict_info<T>& mp, const float fx, uint64_t fi)
 {
   size_t index = fi;
@@ -401,7 +674,19 @@ void multipredict(gd& g, base_learner&, example& ec, size_t count, size_t step,
   vw& all = *g.all;
   for (size_t c=0; c<count; c++)
     pred[c].scalar = ec.l.simple.initial;
-  if (g.all->weights.sparse)
+  if (g.all->weights.serving_bits == 8)
+  {
+    multipredict_info<int8_parameters> mp =
+    { count, step, pred, g.all->weights.int8_weights, 0.f };
+    foreach_feature<multipredict_info<int8_parameters>, uint64_t, vec_add_multipredict>(all, ec, mp);
+  }
+  else if (g.all->weights.serving_bits == 16)
+  {
+    multipredict_info<fp16_parameters> mp =
+    { count, step, pred, g.all->weights.fp16_weights, 0.f };
+    foreach_feature<multipredict_info<fp16_parameters>, uint64_t, vec_add_multipredict>(all, ec, mp);
+  }
+  else if (g.all->weights.sparse)
   {
     multipredict_info<sparse_parameters> mp =
     { count, step, pred, g.all->weights.sparse_weights, (float)all.sd->gravity };
@@ -475,13 +760,14 @@ struct norm_data
   float norm_x;
   power_data pd;
   float extra_state[4];
+  uint32_t dither;
 };
 
 const float x_min = 1.084202e-19f;
 const float x2_min = x_min*x_min;
 const float x2_max = FLT_MAX;
 
-template<bool sqrt_rate, bool feature_mask_off, size_t adaptive, size_t normalized, size_t spare, bool stateless>
+template<bool sqrt_rate, bool feature_mask_off, size_t adaptive, size_t normalized, size_t spare, bool stateless, bool half_state>
 inline void pred_per_update_feature(norm_data& nd, float x, float& fw)
 {
   if(feature_mask_off || fw != 0.)
@@ -495,11 +781,11 @@ inline void pred_per_update_feature(norm_data& nd, float x, float& fw)
     }
     if (x2 > x2_max)
       THROW("your features have too much magnitude");
-    if (stateless) // we must not modify the parameter state so introduce a shadow version.
+    if (stateless || half_state) // we must not modify the parameter state, or it is 16 bit, so introduce a shadow version.
     {
+      nd.extra_state[adaptive]= half_state ? half_adaptive(w) : w[adaptive];
+      nd.extra_state[normalized]= half_state ? half_normalized(w) : w[normalized];
       nd.extra_state[0]=w[0];
-      nd.extra_state[adaptive]=w[adaptive];
-      nd.extra_state[normalized]=w[normalized];
       w = nd.extra_state;
     }
     if(adaptive)
@@ -528,12 +814,50 @@ inline void pred_per_update_feature(norm_data& nd, float x, float& fw)
     }
     w[spare] = compute_rate_decay<sqrt_rate, adaptive, normalized>(nd.pd, w[0]);
     nd.pred_per_update += x2 * w[spare];
+    if (half_state && !stateless)
+    {
+      if (normalized)
+        fw = w[0];
+      if (adaptive)
+      {
+        nd.dither ^= nd.dither << 13;
+        nd.dither ^= nd.dither >> 17;
+        nd.dither ^= nd.dither << 5;
+        set_half_adaptive(&fw, w[adaptive], (uint16_t)nd.dither);
+      }
+      if (normalized)
+        set_half_normalized(&fw, w[normalized]);
+    }
   }
 }
 
+template<bool sqrt_rate, bool feature_mask_off, size_t adaptive, size_t normalized, size_t spare>
+void pred_per_update_dense(norm_data& nd, weight* w, uint64_t step, const float* x, size_t n)
+{
+  size_t i = 0;
+  if (sqrt_rate)
+  {
+    strided_norm dn = {nd.grad_squared, x_min, adaptive, normalized, spare, !feature_mask_off, nd.pred_per_update, nd.norm_x};
+    i = strided_pred_per_update(w, step, x, n, dn);
+    nd.pred_per_update = dn.pred_per_update;
+    nd.norm_x = dn.norm_x;
+  }
+  for (; i < n; i++)
+    pred_per_update_feature<sqrt_rate, feature_mask_off, adaptive, normalized, spare, false, false>(nd, x[i], w[i * step]);
+}
+
+// --threads learn through one gd, so the sums the normalizer comes from are added to atomically
+inline double add_to(atomic<double>& sum, double x)
+{
+  double s = sum.load(memory_order_relaxed);
+  while (!sum.compare_exchange_weak(s, s + x, memory_order_relaxed));
+  return s + x;
+}
+
 bool global_print_features = false;
-template<bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare, bool stateless>
-float get_pred_per_update(gd& g, example& ec)
+// update_multiplier is left as the normalizer of the example for train
+template<bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare, bool stateless, bool half_state>
+float get_pred_per_update(gd& g, example& ec, float& update_multiplier)
 {
   //We must traverse the features in _precisely_ the same order as during training.
   label_data& ld = ec.l.simple;
@@ -546,31 +870,37 @@ float get_pred_per_update(gd& g, example& ec)
   if (grad_squared == 0 && !stateless) return 1.;
 
   norm_data nd = {grad_squared, 0., 0., {g.neg_power_t, g.neg_norm_power}};
-  foreach_feature<norm_data,pred_per_update_feature<sqrt_rate, feature_mask_off, adaptive, normalized, spare, stateless> >(all, ec, nd);
+  if (half_state && !stateless)
+    nd.dither = g.dither = g.dither * 1664525 + 1013904223;
+  if (stateless || half_state || all.weights.sparse)
+    foreach_feature<norm_data, float&, pred_per_update_feature<sqrt_rate, feature_mask_off, adaptive, normalized, spare, stateless, half_state> >(g, ec, nd);
+  else
+    foreach_dense_feature<norm_data, float&, pred_per_update_feature<sqrt_rate, feature_mask_off, adaptive, normalized, spare, false, false>,
+                          pred_per_update_dense<sqrt_rate, feature_mask_off, adaptive, normalized, spare> >(g, ec, nd);
   if(normalized)
   {
     if(!stateless)
     {
-      g.all->normalized_sum_norm_x += ((double)ec.weight) * nd.norm_x;
-      g.total_weight += ec.weight;
-      g.update_multiplier = average_update<sqrt_rate, adaptive, normalized>((float)g.total_weight, (float)g.all->normalized_sum_norm_x, g.neg_norm_power);
+      double nsnx = add_to(g.all->normalized_sum_norm_x, ((double)ec.weight) * nd.norm_x);
+      double tw = add_to(g.total_weight, ec.weight);
+      update_multiplier = average_update<sqrt_rate, adaptive, normalized>((float)tw, (float)nsnx, g.neg_norm_power);
     }
     else
     {
-      float nsnx = ((float)g.all->normalized_sum_norm_x) + ec.weight * nd.norm_x;
-      float tw = (float)g.total_weight + ec.weight;
-      g.update_multiplier = average_update<sqrt_rate, adaptive, normalized>(tw, nsnx, g.neg_norm_power);
+      float nsnx = ((float)g.all->normalized_sum_norm_x.load()) + ec.weight * nd.norm_x;
+      float tw = (float)g.total_weight.load() + ec.weight;
+      update_multiplier = average_update<sqrt_rate, adaptive, normalized>(tw, nsnx, g.neg_norm_power);
     }
-    nd.pred_per_update *= g.update_multiplier;
+    nd.pred_per_update *= update_multiplier;
   }
   return nd.pred_per_update;
 }
 
-template<bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare, bool stateless>
-float sensitivity(gd& g, example& ec)
+template<bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare, bool stateless, bool half_state>
+float sensitivity(gd& g, example& ec, float& update_multiplier)
 {
   if(adaptive || normalized)
-    return get_pred_per_update<sqrt_rate, feature_mask_off, adax, adaptive, normalized, spare, stateless>(g,ec);
+    return get_pred_per_update<sqrt_rate, feature_mask_off, adax, adaptive, normalized, spare, stateless, half_state>(g,ec,update_multiplier);
   else
     return ec.total_sum_feat_sq;
 }
@@ -587,15 +917,45 @@ float get_scale(gd& g, example& ec, float weight)
   return update_scale;
 }
 
-template<bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare>
+template<bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare, bool half_state>
 float sensitivity(gd& g, base_learner& base, example& ec)
 {
+  float update_multiplier;
   return get_scale<adaptive>(g, ec, 1.)
-         * sensitivity<sqrt_rate, feature_mask_off, adax, adaptive, normalized, spare, true>(g,ec);
+         * sensitivity<sqrt_rate, feature_mask_off, adax, adaptive, normalized, spare, true, half_state>(g,ec,update_multiplier);
 }
 
-template<bool sparse_l2, bool invariant, bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare>
-float compute_update(gd& g, example& ec)
+struct half_update
+{
+  float update;
+  power_data pd;
+};
+
+// the rate decay pred_per_update_feature kept in w[spare] is not stored with --half_state, so it is computed again
+template<bool sqrt_rate, bool feature_mask_off, size_t adaptive, size_t normalized>
+inline void half_update_feature(half_update& u, float x, float& fw)
+{
+  if(feature_mask_off || fw != 0.)
+  {
+    float state[4];
+    state[adaptive] = half_adaptive(&fw);
+    state[normalized] = half_normalized(&fw);
+    state[0] = fw;
+    fw += u.update * x * compute_rate_decay<sqrt_rate, adaptive, normalized>(u.pd, state[0]);
+  }
+}
+
+template<bool sqrt_rate, bool feature_mask_off, size_t adaptive, size_t normalized>
+void train_half(gd& g, example& ec, float update, float update_multiplier)
+{
+  if (normalized)
+    update *= update_multiplier;
+  half_update u = {update, {g.neg_power_t, g.neg_norm_power}};
+  foreach_feature<half_update, float&, half_update_feature<sqrt_rate, feature_mask_off, adaptive, normalized> >(g, ec, u);
+}
+
+template<bool sparse_l2, bool invariant, bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare, bool half_state>
+float compute_update(gd& g, example& ec, float& update_multiplier)
 {
   //invariant: not a test label, importance weight > 0
   label_data& ld = ec.l.simple;
@@ -605,7 +965,7 @@ float compute_update(gd& g, example& ec)
   ec.updated_prediction = ec.pred.scalar;
   if (all.loss->getLoss(all.sd, ec.pred.scalar, ld.label) > 0.)
   {
-    float pred_per_update = sensitivity<sqrt_rate, feature_mask_off, adax, adaptive, normalized, spare, false>(g, ec);
+    float pred_per_update = sensitivity<sqrt_rate, feature_mask_off, adax, adaptive, normalized, spare, false, half_state>(g, ec, update_multiplier);
     float update_scale = get_scale<adaptive>(g, ec, ec.weight);
     if(invariant)
       update = all.loss->getUpdate(ec.pred.scalar, ld.label, update_scale, pred_per_update);
@@ -631,27 +991,36 @@ float compute_update(gd& g, example& ec)
   return update;
 }
 
-template<bool sparse_l2, bool invariant, bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare>
+template<bool sparse_l2, bool invariant, bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare, bool half_state>
 void update(gd& g, base_learner&, example& ec)
 {
   //invariant: not a test label, importance weight > 0
   float update;
-  if ( (update = compute_update<sparse_l2, invariant, sqrt_rate, feature_mask_off, adax, adaptive, normalized, spare> (g, ec)) != 0.)
-    train<sqrt_rate, feature_mask_off, adaptive, normalized, spare>(g, ec, update);
+  float update_multiplier = 1.f;
+  if ( (update = compute_update<sparse_l2, invariant, sqrt_rate, feature_mask_off, adax, adaptive, normalized, spare, half_state> (g, ec, update_multiplier)) != 0.)
+  {
+    if (half_state)
+      train_half<sqrt_rate, feature_mask_off, adaptive, normalized>(g, ec, update, update_multiplier);
+    else
+      train<sqrt_rate, feature_mask_off, adaptive, normalized, spare>(g, ec, update, update_multiplier);
+  }
 
   if (g.all->sd->contraction < 1e-9 || g.all->sd->gravity > 1e3)  // updating weights now to avoid numerical instability
     sync_weights(*g.all);
 }
 
-template<bool sparse_l2, bool invariant, bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare>
+template<bool sparse_l2, bool invariant, bool sqrt_rate, bool feature_mask_off, bool adax, size_t adaptive, size_t normalized, size_t spare, bool half_state>
 void learn(gd& g, base_learner& base, example& ec)
 {
   //invariant: not a test label, importance weight > 0
   assert(ec.in_use);
   assert(ec.l.simple.label != FLT_MAX);
   assert(ec.weight > 0.);
+  uncache_interactions uncache = { g };
+  if (g.cache_interactions && !g.all->interactions.empty())
+    cache_interactions(g, ec);
   g.predict(g,base,ec);
-  update<sparse_l2, invariant, sqrt_rate, feature_mask_off, adax, adaptive, normalized, spare>(g,base,ec);
+  update<sparse_l2, invariant, sqrt_rate, feature_mask_off, adax, adaptive, normalized, spare, half_state>(g,base,ec);
 }
 
 void sync_weights(vw& all)
@@ -671,6 +1040,416 @@ void sync_weights(vw& all)
   all.sd->contraction = 1.;
 }
 
+/* With --aligned_model the regressor is an index of all ones, which older
+   readers reject as out of range, then a dense_block_header and, from an
+   offset in the file that is a multiple of dense_block_alignment, one float
+   per weight.  That is the layout of the weights in vw -t, which keeps no
+   learning state next to them, so it maps the block instead of reading it. */
+const uint64_t dense_block_magic = 0x314b434f4c425744ULL; // "DWBLOCK1"
+const size_t dense_block_alignment = 1 << 16;
+const size_t dense_block_chunk = 1 << 14; // floats
+
+struct dense_block_header
+{
+  uint64_t magic;
+  uint64_t padding; // zero bytes between the header and the block
+  uint64_t floats;
+};
+
+void write_block_marker(vw& all, io_buf& model_file)
+{
+  if (all.num_bits < 31)
+  {
+    uint32_t marker = ~(uint32_t)0;
+    bin_write_fixed(model_file, (char*)&marker, sizeof(marker));
+  }
+  else
+  {
+    uint64_t marker = ~(uint64_t)0;
+    bin_write_fixed(model_file, (char*)&marker, sizeof(marker));
+  }
+}
+
+void save_dense_block(vw& all, io_buf& model_file, dense_parameters& weights)
+{
+  write_block_marker(all, model_file);
+  dense_block_header header = { dense_block_magic, 0, (uint64_t)1 << all.num_bits };
+  int64_t offset = model_file.files.size() > 0 ? model_file.tell_file(model_file.files[0], true) : -1;
+  if (offset >= 0) // otherwise the block can't be mapped, but still reads
+    header.padding = (dense_block_alignment - (offset + sizeof(header)) % dense_block_alignment) % dense_block_alignment;
+  bin_write_fixed(model_file, (char*)&header, sizeof(header));
+
+  vector<weight> floats(dense_block_chunk);
+  for (size_t left = header.padding; left > 0; left -= min(left, floats.size() * sizeof(weight)))
+    bin_write_fixed(model_file, (char*)floats.data(), min(left, floats.size() * sizeof(weight)));
+  for (uint64_t done = 0; done < header.floats; done += floats.size())
+  {
+    size_t n = (size_t)min((uint64_t)floats.size(), header.floats - done);
+    for (size_t j = 0; j < n; j++)
+      floats[j] = weights.strided_index(done + j);
+    bin_write_fixed(model_file, (char*)floats.data(), n * sizeof(weight));
+  }
+}
+
+void save_dense_block(vw&, io_buf&, sparse_parameters&)
+{ THROW("--aligned_model saves dense weights, it can't be combined with --sparse_weights"); }
+
+weight* map_dense_block(vw&, io_buf&, const dense_block_header&, sparse_parameters&, size_t&) { return nullptr; }
+void use_mapping(sparse_parameters&, weight*, size_t) {}
+void use_mapping(dense_parameters& weights, weight* mapped, size_t mapped_length) { weights.use_mapping(mapped, mapped_length); }
+
+weight* map_dense_block(vw& all, io_buf& model_file, const dense_block_header& header, dense_parameters& weights, size_t& mapped_length)
+{ // learning writes every weight it touches, so only a predicting vw maps, and a daemon shares a copy with its children
+  if (all.training || all.daemon || weights.stride_shift() != 0 || model_file.compressed() || model_file.current >= model_file.files.size())
+    return nullptr;
+  int f = model_file.files[model_file.current];
+  int64_t offset = model_file.tell_file(f, false);
+  if (offset < 0 || offset % dense_block_alignment != 0)
+    return nullptr;
+  return (weight*)map_weight_file(f, offset, header.floats * sizeof(weight), mapped_length);
+}
+
+template<class T>
+void load_dense_block(vw& all, io_buf& model_file, const dense_block_header& header, T& weights)
+{
+  if (header.magic != dense_block_magic || header.floats != (uint64_t)1 << all.num_bits)
+    THROW("Model content is corrupted, the dense weight block header is invalid");
+
+  vector<weight> floats(dense_block_chunk);
+  for (size_t left = header.padding; left > 0; left -= min(left, floats.size() * sizeof(weight)))
+    if (bin_read_fixed(model_file, (char*)floats.data(), min(left, floats.size() * sizeof(weight)), "") == 0)
+      THROW("Model content is corrupted, the dense weight block is truncated");
+
+  size_t mapped_length = 0;
+  weight* mapped = map_dense_block(all, model_file, header, weights, mapped_length);
+  for (uint64_t done = 0; done < header.floats; done += floats.size())
+  {
+    size_t n = (size_t)min((uint64_t)floats.size(), header.floats - done);
+    if (bin_read_fixed(model_file, (char*)floats.data(), n * sizeof(weight), "") != n * sizeof(weight))
+      THROW("Model content is corrupted, the dense weight block is truncated");
+    if (mapped != nullptr)
+    { // the first chunk checks that the mapping holds the bytes the stream does
+      if (memcmp(mapped, floats.data(), n * sizeof(weight)) == 0)
+      {
+        use_mapping(weights, mapped, mapped_length);
+        if (!all.quiet)
+          all.opts_n_args.trace_message << "weights mapped from the model file" << endl;
+        return;
+      }
+      free_weight_pages(mapped, mapped_length);
+      mapped = nullptr;
+    }
+    for (size_t j = 0; j < n; j++)
+      if (floats[j] != 0.)
+        weights.strided_index(done + j) = floats[j];
+  }
+}
+
+/* --export_serving_model writes the same index of all ones as --aligned_model,
+   then a serving_block_header and one weight per index: a float scale for
+   every 1 << int8_block_shift weights followed by the int8 weights, or IEEE
+   half floats.  The learning state is left out, so the file only predicts. */
+const uint64_t serving_block_magic = 0x314b434f4c425751ULL; // "QWBLOCK1"
+
+struct serving_block_header
+{
+  uint64_t magic;
+  uint64_t bits; // per weight, 8 or 16
+  uint64_t weights;
+};
+
+void save_serving_block(vw& all, io_buf& model_file, dense_parameters& weights)
+{
+  write_block_marker(all, model_file);
+  serving_block_header header = { serving_block_magic, all.serving_bits, (uint64_t)1 << all.num_bits };
+  bin_write_fixed(model_file, (char*)&header, sizeof(header));
+
+  // the weights vw -t would use, with any pending l1 and l2 applied
+  vector<float> floats((size_t)header.weights);
+  for (size_t j = 0; j < floats.size(); j++)
+    floats[j] = trunc_weight(weights.strided_index(j), (float)all.sd->gravity) * (float)all.sd->contraction;
+
+  if (header.bits == 8)
+  {
+    vector<float> scales(int8_parameters::scales(floats.size()));
+    vector<int8_t> values(floats.size());
+    for (size_t b = 0; b < scales.size(); b++)
+    {
+      size_t begin = b << int8_block_shift;
+      size_t end = min(floats.size(), begin + ((size_t)1 << int8_block_shift));
+      float largest = 0.f;
+      for (size_t j = begin; j < end; j++)
+        largest = max(largest, fabsf(floats[j]));
+      scales[b] = largest / 127.f;
+      for (size_t j = begin; j < end; j++)
+        values[j] = largest > 0.f ? (int8_t)lrintf(floats[j] / scales[b]) : 0;
+    }
+    bin_write_fixed(model_file, (char*)scales.data(), scales.size() * sizeof(float));
+    bin_write_fixed(model_file, (char*)values.data(), values.size() * sizeof(int8_t));
+  }
+  else
+  {
+    vector<uint16_t> values(floats.size());
+    for (size_t j = 0; j < floats.size(); j++)
+      values[j] = float_to_half(floats[j]);
+    bin_write_fixed(model_file, (char*)values.data(), values.size() * sizeof(uint16_t));
+  }
+}
+
+void save_serving_block(vw&, io_buf&, sparse_parameters&)
+{ THROW("--export_serving_model saves dense weights, it can't be combined with --sparse_weights"); }
+
+void read_serving_values(io_buf& model_file, char* values, size_t length)
+{ // in chunks, as io_buf grows its buffer to the largest read
+  for (size_t done = 0; done < length; done += dense_block_chunk * sizeof(weight))
+  {
+    size_t n = min(length - done, dense_block_chunk * sizeof(weight));
+    if (bin_read_fixed(model_file, values + done, n, "") != n)
+      THROW("Model content is corrupted, the serving weights are truncated");
+  }
+}
+
+template<class T>
+void load_serving_block(vw& all, io_buf& model_file, const serving_block_header& header, T& weights)
+{
+  if ((header.bits != 8 && header.bits != 16) || header.weights != (uint64_t)1 << all.num_bits)
+    THROW("Model content is corrupted, the serving weight block header is invalid");
+  if (all.training)
+    THROW("a model from --export_serving_model only predicts, use it with -t");
+  if (all.audit || all.hash_inv)
+    THROW("a model from --export_serving_model keeps no float weights to audit");
+  if (all.weights.sparse || all.swap != nullptr)
+    THROW("a model from --export_serving_model can't be loaded into --sparse_weights or swapped with --hot_swap");
+
+  size_t length = (size_t)header.weights;
+  parameters& p = all.weights;
+  if (header.bits == 8)
+  {
+    p.int8_weights.allocate(length, weights.stride_shift(), all.weights.dense_weights.prefetch_distance());
+    read_serving_values(model_file, (char*)p.int8_weights.scales(), int8_parameters::scales(length) * sizeof(float));
+    read_serving_values(model_file, (char*)p.int8_weights.values(), length * sizeof(int8_t));
+  }
+  else
+  {
+    p.fp16_weights.allocate(length, weights.stride_shift(), all.weights.dense_weights.prefetch_distance());
+    read_serving_values(model_file, (char*)p.fp16_weights.values(), length * sizeof(uint16_t));
+  }
+  p.serving_bits = (uint32_t)header.bits;
+  if (!all.quiet)
+    all.opts_n_args.trace_message << "predicting with " << (header.bits == 8 ? "int8" : "fp16") << " serving weights" << endl;
+}
+
+/* A binary model of dense weights is, from VERSION_FILE_WITH_WEIGHT_CHUNKS
+   on, the same index of all ones as --aligned_model, a weight_chunks_header
+   and then, for each range of chunk_weights indices in order, the number of
+   nonzero weights in it followed by an entry for each: its uint32 offset in
+   the range and its floats.  Ranges are independent, so model_threads
+   threads encode or decode a wave of them at once while the file is written
+   or read in order, and a wave at a time is all that is held in memory. */
+const uint64_t weight_chunks_magic = 0x314b4e5548435743ULL; // "CWCHUNK1"
+const uint64_t chunk_weights = 1 << 16;
+
+struct weight_chunks_header
+{
+  uint64_t magic;
+  uint64_t values; // floats per weight
+  uint64_t chunk_weights;
+};
+
+// the floats of a weight in a model without learning state
+struct regressor_values
+{
+  size_t count() const { return 1; }
+  void get(const weight* w, weight* buff) const { buff[0] = w[0]; }
+  void set(weight* w, const weight* buff) const { w[0] = buff[0]; }
+};
+
+// the floats of a weight in a --save_resume model
+struct online_state_values
+{
+  gd* g;
+  uint32_t stride;
+
+  size_t count() const
+  {
+    if (g == nullptr || (!g->adaptive && !g->normalized))
+      return 1;
+    return g->adaptive && g->normalized ? 3 : 2;
+  }
+
+  void get(const weight* w, weight* buff) const
+  {
+    buff[0] = w[0];
+    if (g == nullptr || (!g->adaptive && !g->normalized))
+      return;
+    buff[1] = w[1];
+    if (g->half_state) // the file keeps the state as floats
+    {
+      buff[1] = g->adaptive ? half_adaptive(w) : half_normalized(w);
+      buff[2] = half_normalized(w);
+    }
+    else if (g->adaptive && g->normalized)
+      buff[2] = w[2];
+  }
+
+  void set(weight* w, const weight* buff) const
+  {
+    if (g != nullptr && g->half_state)
+    {
+      w[0] = buff[0];
+      if (g->adaptive)
+        set_half_adaptive(w, buff[1], 0x8000);
+      if (g->normalized)
+        set_half_normalized(w, buff[g->adaptive ? 2 : 1]);
+    }
+    else // buff holds 4 floats, zero past count()
+      for (size_t i = 0; i < stride && i < 4; i++)
+        w[i] = buff[i];
+  }
+};
+
+size_t model_threads(vw& all, size_t chunks)
+{
+  size_t threads = all.model_threads > 0 ? all.model_threads : thread::hardware_concurrency();
+  return max((size_t)1, min(threads, chunks));
+}
+
+// calls f(0) ... f(n - 1), each on its own thread
+template<class F>
+void in_parallel(size_t n, F f)
+{
+  vector<thread> threads;
+  for (size_t t = 1; t < n; t++)
+    threads.push_back(thread(f, t));
+  f(0);
+  for (size_t t = 0; t < threads.size(); t++)
+    threads[t].join();
+}
+
+template<class V>
+void encode_chunk(dense_parameters& weights, const V& values, uint64_t first, uint64_t count, vector<char>& encoded)
+{
+  size_t entry = sizeof(uint32_t) + values.count() * sizeof(weight);
+  encoded.resize(sizeof(uint64_t));
+  uint64_t entries = 0;
+  for (uint64_t j = 0; j < count; j++)
+  {
+    weight* w = &weights.strided_index(first + j);
+    if (*w == 0.)
+      continue;
+    encoded.resize(encoded.size() + entry);
+    char* e = encoded.data() + encoded.size() - entry;
+    uint32_t offset = (uint32_t)j;
+    weight buff[3];
+    values.get(w, buff);
+    memcpy(e, &offset, sizeof(offset));
+    memcpy(e + sizeof(offset), buff, values.count() * sizeof(weight));
+    entries++;
+  }
+  memcpy(encoded.data(), &entries, sizeof(entries));
+}
+
+// false if an offset is outside the chunk
+template<class T, class V>
+bool decode_chunk(T& weights, const V& values, uint64_t first, uint64_t count, const vector<char>& encoded)
+{
+  size_t entry = sizeof(uint32_t) + values.count() * sizeof(weight);
+  for (const char* e = encoded.data(); e < encoded.data() + encoded.size(); e += entry)
+  {
+    uint32_t offset;
+    weight buff[4] = { 0, 0, 0, 0 };
+    memcpy(&offset, e, sizeof(offset));
+    memcpy(buff, e + sizeof(offset), values.count() * sizeof(weight));
+    if (offset >= count)
+      return false;
+    values.set(&weights.strided_index(first + offset), buff);
+  }
+  return true;
+}
+
+template<class V>
+bool save_weight_chunks(vw& all, io_buf& model_file, dense_parameters& weights, const V& values)
+{
+  uint64_t length = (uint64_t)1 << all.num_bits;
+  weight_chunks_header header = { weight_chunks_magic, values.count(), min(chunk_weights, length) };
+  write_block_marker(all, model_file);
+  bin_write_fixed(model_file, (char*)&header, sizeof(header));
+
+  size_t chunks = (size_t)(length / header.chunk_weights);
+  vector<vector<char>> encoded(model_threads(all, chunks));
+  for (size_t c = 0; c < chunks; c += encoded.size())
+  {
+    size_t wave = min(encoded.size(), chunks - c);
+    in_parallel(wave, [&](size_t t)
+    { encode_chunk(weights, values, (c + t) * header.chunk_weights, header.chunk_weights, encoded[t]); });
+    for (size_t t = 0; t < wave; t++)
+      bin_write_fixed(model_file, encoded[t].data(), encoded[t].size());
+  }
+  return true;
+}
+
+// sparse weights, whose lookups may insert, keep (index, floats) pairs
+template<class V>
+bool save_weight_chunks(vw&, io_buf&, sparse_parameters&, const V&) { return false; }
+
+template<class T, class V>
+void load_weight_chunks(vw& all, io_buf& model_file, const weight_chunks_header& header, T& weights, const V& values)
+{
+  uint64_t length = (uint64_t)1 << all.num_bits;
+  if (all.model_file_ver < VERSION_FILE_WITH_WEIGHT_CHUNKS || header.values != values.count()
+      || header.chunk_weights == 0 || header.chunk_weights > length || length % header.chunk_weights != 0)
+    THROW("Model content is corrupted, the weight chunks header is invalid");
+
+  size_t chunks = (size_t)(length / header.chunk_weights);
+  size_t entry = sizeof(uint32_t) + values.count() * sizeof(weight);
+  vector<vector<char>> encoded(all.weights.sparse ? 1 : model_threads(all, chunks));
+  for (size_t c = 0; c < chunks; c += encoded.size())
+  {
+    size_t wave = min(encoded.size(), chunks - c);
+    for (size_t t = 0; t < wave; t++)
+    {
+      uint64_t entries;
+      if (bin_read_fixed(model_file, (char*)&entries, sizeof(entries), "") != sizeof(entries) || entries > header.chunk_weights)
+        THROW("Model content is corrupted, a weight chunk is truncated");
+      encoded[t].resize((size_t)entries * entry);
+      for (size_t done = 0; done < encoded[t].size(); done += dense_block_chunk * sizeof(weight))
+      {
+        size_t n = min(encoded[t].size() - done, dense_block_chunk * sizeof(weight));
+        if (bin_read_fixed(model_file, encoded[t].data() + done, n, "") != n)
+          THROW("Model content is corrupted, a weight chunk is truncated");
+      }
+    }
+    vector<char> valid(wave);
+    in_parallel(wave, [&](size_t t)
+    { valid[t] = decode_chunk(weights, values, (c + t) * header.chunk_weights, header.chunk_weights, encoded[t]); });
+    for (size_t t = 0; t < wave; t++)
+      if (!valid[t])
+        THROW("Model content is corrupted, a weight chunk holds an index outside it");
+  }
+}
+
+template<class T>
+void load_weight_block(vw& all, io_buf& model_file, T& weights)
+{
+  dense_block_header header;
+  if (bin_read_fixed(model_file, (char*)&header, sizeof(header), "") != sizeof(header))
+    THROW("Model content is corrupted, the weight block header is truncated");
+  if (header.magic == serving_block_magic)
+  {
+    serving_block_header serving;
+    memcpy(&serving, &header, sizeof(serving));
+    load_serving_block(all, model_file, serving, weights);
+  }
+  else if (header.magic == weight_chunks_magic)
+  {
+    weight_chunks_header chunks;
+    memcpy(&chunks, &header, sizeof(chunks));
+    load_weight_chunks(all, model_file, chunks, weights, regressor_values());
+  }
+  else
+    load_dense_block(all, model_file, header, weights);
+}
+
 template<class T>
 void save_load_regressor(vw& all, io_buf& model_file, bool read, bool text, T& weights)
 {
@@ -700,6 +1479,8 @@ void save_load_regressor(vw& all, io_buf& model_file, bool read, bool text, T& w
   uint64_t i = 0;
   uint32_t old_i = 0;
   uint64_t length = (uint64_t)1 << all.num_bits;
+  if (!read && all.weights.serving_bits != 0)
+    THROW("the weights of a model from --export_serving_model can't be saved again");
   if (read)
     do
     {
@@ -711,6 +1492,11 @@ void save_load_regressor(vw& all, io_buf& model_file, bool read, bool text, T& w
       }
       else
         brw = bin_read_fixed(model_file, (char*)&i, sizeof(i), "");
+      if (brw > 0 && (all.num_bits < 31 ? old_i == ~(uint32_t)0 : i == ~(uint64_t)0))
+      {
+        load_weight_block(all, model_file, weights);
+        break;
+      }
       if (brw > 0)
       {
         if (i >= length)
@@ -720,6 +1506,12 @@ void save_load_regressor(vw& all, io_buf& model_file, bool read, bool text, T& w
       }
     }
     while (brw >0);
+  else if (all.serving_export)
+    save_serving_block(all, model_file, weights);
+  else if (all.aligned_model && !text)
+    save_dense_block(all, model_file, weights);
+  else if (!text && save_weight_chunks(all, model_file, weights, regressor_values()))
+    return;
   else // write
     for (typename T::iterator v = weights.begin(); v != weights.end(); ++v)
       if (*v != 0.)
@@ -758,6 +1550,7 @@ void save_load_online_state(vw& all, io_buf& model_file, bool read, bool text, g
   uint64_t i = 0;
   uint32_t old_i = 0;
   size_t brw = 1;
+  online_state_values values = { g, (uint32_t)1 << weights.stride_shift() };
 
   if (read)
     do
@@ -770,24 +1563,26 @@ void save_load_online_state(vw& all, io_buf& model_file, bool read, bool text, g
       }
       else
         brw = bin_read_fixed(model_file, (char*)&i, sizeof(i), "");
+      if (brw > 0 && (all.num_bits < 31 ? old_i == ~(uint32_t)0 : i == ~(uint64_t)0))
+      {
+        weight_chunks_header header;
+        if (bin_read_fixed(model_file, (char*)&header, sizeof(header), "") != sizeof(header) || header.magic != weight_chunks_magic)
+          THROW("Model content is corrupted, the weight chunks header is invalid");
+        load_weight_chunks(all, model_file, header, weights, values);
+        break;
+      }
       if (brw > 0)
       {
         if (i >= length)
           THROW("Model content is corrupted, weight vector index " << i << " must be less than total vector length " << length);
         weight buff[4] = {0,0,0,0};
-        if (g == NULL || (!g->adaptive && !g->normalized))
-          brw += bin_read_fixed(model_file, (char*)buff, sizeof(buff[0]), "");
-        else if ((g->adaptive && !g->normalized) || (!g->adaptive && g->normalized))
-          brw += bin_read_fixed(model_file, (char*)buff, sizeof(buff[0]) * 2, "");
-        else //adaptive and normalized
-          brw += bin_read_fixed(model_file, (char*)buff, sizeof(buff[0]) * 3, "");
-        uint32_t stride = 1 << weights.stride_shift();
-        weight* v = &weights.strided_index(i);
-        for (size_t i = 0; i < stride; i++)
-          v[i] = buff[i];
+        brw += bin_read_fixed(model_file, (char*)buff, sizeof(buff[0]) * values.count(), "");
+        values.set(&weights.strided_index(i), buff);
       }
     }
     while (brw >0);
+  else if (!text && save_weight_chunks(all, model_file, weights, values))
+    return;
   else // write binary or text
     for (typename T::iterator v = weights.begin(); v != weights.end(); ++v)
       if (*v != 0.)
@@ -808,19 +1603,24 @@ void save_load_online_state(vw& all, io_buf& model_file, bool read, bool text, g
           brw += bin_text_write_fixed(model_file, (char *)&(*v), sizeof(*v),
                                       msg, text);
         }
-        else if ((g->adaptive && !g->normalized) || (!g->adaptive && g->normalized))
-        {
-          //either adaptive or normalized
-          msg << ":" << *v << " " << (&(*v))[1] << "\n";
-          brw += bin_text_write_fixed(model_file, (char *)&(*v), 2 * sizeof(*v),
-                                      msg, text);
-        }
         else
         {
-          //adaptive and normalized
-          msg << ":" << *v << " " << (&(*v))[1] << " " << (&(*v))[2] << "\n";
-          brw += bin_text_write_fixed(model_file, (char *)&(*v), 3 * sizeof(*v),
-                                      msg, text);
+          weight buff[3] = { 0, 0, 0 };
+          values.get(&(*v), buff);
+          if ((g->adaptive && !g->normalized) || (!g->adaptive && g->normalized))
+          {
+            //either adaptive or normalized
+            msg << ":" << buff[0] << " " << buff[1] << "\n";
+            brw += bin_text_write_fixed(model_file, (char *)buff, 2 * sizeof(*v),
+                                        msg, text);
+          }
+          else
+          {
+            //adaptive and normalized
+            msg << ":" << buff[0] << " " << buff[1] << " " << buff[2] << "\n";
+            brw += bin_text_write_fixed(model_file, (char *)buff, 3 * sizeof(*v),
+                                        msg, text);
+          }
         }
       }
 }
@@ -834,9 +1634,11 @@ void save_load_online_state(vw& all, io_buf& model_file, bool read, bool text, g
   bin_text_read_write_fixed(model_file, (char*)&all.initial_t, sizeof(all.initial_t),
                             "", read, msg, text);
 
-  msg << "norm normalizer " << all.normalized_sum_norm_x << "\n";
-  bin_text_read_write_fixed(model_file, (char*)&all.normalized_sum_norm_x, sizeof(all.normalized_sum_norm_x),
+  double normalized_sum_norm_x = all.normalized_sum_norm_x;
+  msg << "norm normalizer " << normalized_sum_norm_x << "\n";
+  bin_text_read_write_fixed(model_file, (char*)&normalized_sum_norm_x, sizeof(normalized_sum_norm_x),
                             "", read, msg, text);
+  all.normalized_sum_norm_x = normalized_sum_norm_x;
 
   msg << "t " << all.sd->t << "\n";
   bin_text_read_write_fixed(model_file, (char*)&all.sd->t, sizeof(all.sd->t),
@@ -945,6 +1747,16 @@ public:
   }
 };
 
+template<class T> class set_initial_half_gd_wrapper
+{
+public:
+  static void func(weight& w, pair<float,float>& initial, uint64_t index)
+  {
+    w = initial.first;
+    set_half_adaptive(&w, initial.second, 0x8000);
+  }
+};
+
 void save_load(gd& g, io_buf& model_file, bool read, bool text)
 {
   vw& all = *g.all;
@@ -956,8 +1768,12 @@ void save_load(gd& g, io_buf& model_file, bool read, bool text)
     {
       float init_weight = all.initial_weight;
       pair<float,float> p = make_pair(init_weight, all.initial_t);
-      if (all.weights.sparse)
+      if (all.weights.sparse && g.half_state)
+        all.weights.sparse_weights.set_default<pair<float,float>, set_initial_half_gd_wrapper<sparse_parameters> >(p);
+      else if (all.weights.sparse)
         all.weights.sparse_weights.set_default<pair<float,float>, set_initial_gd_wrapper<sparse_parameters> >(p);
+      else if (g.half_state)
+        all.weights.dense_weights.set_default<pair<float,float>, set_initial_half_gd_wrapper<dense_parameters> >(p);
       else
         all.weights.dense_weights.set_default<pair<float,float>, set_initial_gd_wrapper<dense_parameters> >(p);
       //for adaptive update, we interpret initial_t as previously seeing initial_t fake datapoints, all with squared gradient=1
@@ -971,7 +1787,7 @@ void save_load(gd& g, io_buf& model_file, bool read, bool text)
 
   if (model_file.files.size() > 0)
   {
-    bool resume = all.save_resume;
+    bool resume = all.save_resume && !all.serving_export;
     stringstream msg;
     msg << ":"<< resume << "\n";
     bin_text_read_write_fixed(model_file,(char *)&resume, sizeof (resume),
@@ -991,62 +1807,73 @@ void save_load(gd& g, io_buf& model_file, bool read, bool text)
     sync_weights(all);
 }
 
-template<bool sparse_l2, bool invariant, bool sqrt_rate, bool feature_mask_off, uint64_t adaptive, uint64_t normalized, uint64_t spare, uint64_t next>
+template<bool sparse_l2, bool invariant, bool sqrt_rate, bool feature_mask_off, uint64_t adaptive, uint64_t normalized, uint64_t spare, bool half_state, uint64_t next>
 uint64_t set_learn(vw& all, gd& g)
 {
   all.normalized_idx = normalized;
   if (g.adax)
   {
-    g.learn = learn<sparse_l2, invariant, sqrt_rate, feature_mask_off, true, adaptive, normalized, spare>;
-    g.update = update<sparse_l2, invariant, sqrt_rate, feature_mask_off, true, adaptive, normalized, spare>;
-    g.sensitivity = sensitivity<sqrt_rate, feature_mask_off, true, adaptive, normalized, spare>;
+    g.learn = learn<sparse_l2, invariant, sqrt_rate, feature_mask_off, true, adaptive, normalized, spare, half_state>;
+    g.update = update<sparse_l2, invariant, sqrt_rate, feature_mask_off, true, adaptive, normalized, spare, half_state>;
+    g.sensitivity = sensitivity<sqrt_rate, feature_mask_off, true, adaptive, normalized, spare, half_state>;
     return next;
   }
   else
   {
-    g.learn = learn<sparse_l2, invariant, sqrt_rate, feature_mask_off, false, adaptive, normalized, spare>;
-    g.update = update<sparse_l2, invariant, sqrt_rate, feature_mask_off, false, adaptive, normalized, spare>;
-    g.sensitivity = sensitivity<sqrt_rate, feature_mask_off, false, adaptive, normalized, spare>;
+    g.learn = learn<sparse_l2, invariant, sqrt_rate, feature_mask_off, false, adaptive, normalized, spare, half_state>;
+    g.update = update<sparse_l2, invariant, sqrt_rate, feature_mask_off, false, adaptive, normalized, spare, half_state>;
+    g.sensitivity = sensitivity<sqrt_rate, feature_mask_off, false, adaptive, normalized, spare, half_state>;
     return next;
   }
 }
 
-template<bool sparse_l2, bool invariant, bool sqrt_rate, uint64_t adaptive, uint64_t normalized, uint64_t spare, uint64_t next>
+template<bool sparse_l2, bool invariant, bool sqrt_rate, uint64_t adaptive, uint64_t normalized, uint64_t spare, bool half_state, uint64_t next>
 uint64_t set_learn(vw& all, bool feature_mask_off, gd& g)
 {
   all.normalized_idx = normalized;
   if (feature_mask_off)
-    return set_learn<sparse_l2, invariant, sqrt_rate, true, adaptive, normalized, spare, next>(all, g);
+    return set_learn<sparse_l2, invariant, sqrt_rate, true, adaptive, normalized, spare, half_state, next>(all, g);
   else
-    return set_learn<sparse_l2, invariant, sqrt_rate, false, adaptive, normalized, spare, next>(all, g);
+    return set_learn<sparse_l2, invariant, sqrt_rate, false, adaptive, normalized, spare, half_state, next>(all, g);
 }
 
-template<bool invariant, bool sqrt_rate, uint64_t adaptive, uint64_t normalized, uint64_t spare, uint64_t next>
+template<bool invariant, bool sqrt_rate, uint64_t adaptive, uint64_t normalized, uint64_t spare, bool half_state, uint64_t next>
 uint64_t set_learn(vw& all, bool feature_mask_off, gd& g)
 {
   if (g.sparse_l2 > 0.f)
-    return set_learn<true, invariant, sqrt_rate, adaptive, normalized, spare, next>(all, feature_mask_off, g);
+    return set_learn<true, invariant, sqrt_rate, adaptive, normalized, spare, half_state, next>(all, feature_mask_off, g);
   else
-    return set_learn<false, invariant, sqrt_rate, adaptive, normalized, spare, next>(all, feature_mask_off, g);
+    return set_learn<false, invariant, sqrt_rate, adaptive, normalized, spare, half_state, next>(all, feature_mask_off, g);
 }
 
-template<bool sqrt_rate, uint64_t adaptive, uint64_t normalized, uint64_t spare, uint64_t next>
+template<bool sqrt_rate, uint64_t adaptive, uint64_t normalized, uint64_t spare, bool half_state, uint64_t next>
 uint64_t set_learn(vw& all, bool feature_mask_off, gd& g)
 {
   if (all.invariant_updates)
-    return set_learn<true, sqrt_rate, adaptive, normalized, spare, next>(all, feature_mask_off, g);
+    return set_learn<true, sqrt_rate, adaptive, normalized, spare, half_state, next>(all, feature_mask_off, g);
   else
-    return set_learn<false, sqrt_rate, adaptive, normalized, spare, next>(all, feature_mask_off, g);
+    return set_learn<false, sqrt_rate, adaptive, normalized, spare, half_state, next>(all, feature_mask_off, g);
 }
 
 template<bool sqrt_rate, uint64_t adaptive, uint64_t spare>
 uint64_t set_learn(vw& all, bool feature_mask_off, gd& g)
 {
   // select the appropriate learn function based on adaptive, normalization, and feature mask
-  if (all.normalized_updates)
-    return set_learn<sqrt_rate, adaptive, adaptive+1, adaptive+2, adaptive+3>(all, feature_mask_off, g);
+  // with half_state the offsets index the float copy of the state the kernels work on, the weights keep it in w[1]
+  if (g.half_state && all.normalized_updates)
+  {
+    set_learn<sqrt_rate, adaptive, adaptive+1, adaptive+2, true, adaptive+3>(all, feature_mask_off, g);
+    return 2;
+  }
+  else if (g.half_state && adaptive)
+  {
+    set_learn<sqrt_rate, adaptive, 0, spare, true, spare+1>(all, feature_mask_off, g);
+    return 2;
+  }
+  else if (all.normalized_updates)
+    return set_learn<sqrt_rate, adaptive, adaptive+1, adaptive+2, false, adaptive+3>(all, feature_mask_off, g);
   else
-    return set_learn<sqrt_rate, adaptive, 0, spare, spare+1>(all, feature_mask_off, g);
+    return set_learn<sqrt_rate, adaptive, 0, spare, false, spare+1>(all, feature_mask_off, g);
 }
 
 template<bool sqrt_rate>
@@ -1058,6 +1885,12 @@ uint64_t set_learn(vw& all, bool feature_mask_off, gd& g)
     return set_learn<sqrt_rate, 0, 0>(all, feature_mask_off, g);
 }
 
+void finish(gd& g)
+{
+  g.interactions.delete_v();
+  g.pairs.delete_v();
+}
+
 uint64_t ceil_log_2(uint64_t v)
 {
   if (v==0)
@@ -1075,6 +1908,8 @@ base_learner* setup(arguments& arg)
       ("adax", "use adaptive learning rates with x^2 instead of g^2x^2")
       ("invariant", "use safe/importance aware updates.")
       ("normalized", "use per feature normalized updates")
+      ("half_state", "keep the adaptive and normalized state of each weight in 16 bits, halving the stride")
+      ("interaction_cache", "generate the interaction features of an example once for its prediction, sensitivity and update while learning")
       ("sparse_l2", g->sparse_l2, 0.f, "use per feature normalized updates")
       ("l1_state", arg.all->sd->gravity, 0., "use per feature normalized updates")
       ("l2_state", arg.all->sd->contraction, 1., "use per feature normalized updates")
@@ -1142,6 +1977,15 @@ base_learner* setup(arguments& arg)
   if(g->adax && !arg.all->adaptive)
     THROW("Cannot use adax without adaptive");
 
+  if (arg.vm.count("half_state"))
+  {
+    g->half_state = arg.all->adaptive || arg.all->normalized_updates;
+    g->dither = (uint32_t)arg.all->random_seed * 2654435761u + 1;
+    arg.all->half_state = g->half_state;
+  }
+
+  g->cache_interactions = arg.vm.count("interaction_cache") > 0;
+
   if (pow((double)arg.all->eta_decay_rate, (double)arg.all->numpasses) < 0.0001 )
     arg.trace_message << "Warning: the learning rate for the last pass is multiplied by: " << pow((double)arg.all->eta_decay_rate, (double)arg.all->numpasses)
                       << " adjust --decay_learning_rate larger to avoid this." << endl;
@@ -1149,19 +1993,23 @@ base_learner* setup(arguments& arg)
   if (arg.all->reg_mode % 2)
     if (arg.all->audit || arg.all->hash_inv)
     {
-      g->predict = predict<true, true>;   g->multipredict = multipredict<true, true>;
+      g->predict = predict<true, true>;   g->multipredict = multipredict<true, true>; g->predict_batch = predict_batch<true, true>;
     }
     else
     {
-      g->predict = predict<true, false>;  g->multipredict = multipredict<true, false>;
+      g->predict = predict<true, false>;  g->multipredict = multipredict<true, false>; g->predict_batch = predict_batch<true, false>;
     }
   else if (arg.all->audit || arg.all->hash_inv)
   {
-    g->predict = predict<false, true>;    g->multipredict = multipredict<false, true>;
+    g->predict = predict<false, true>;    g->multipredict = multipredict<false, true>; g->predict_batch = predict_batch<false, true>;
   }
   else
   {
-    g->predict = predict<false, false>;   g->multipredict = multipredict<false, false>;
+    g->predict = predict<false, false>;   g->multipredict = multipredict<false, false>; g->predict_batch = predict_batch<false, false>;
+  }
+  if (set_predict_only(*arg.all))
+  {
+    g->predict = predict_only;            g->predict_batch = predict_only_batch;
   }
 
   uint64_t stride;
@@ -1176,9 +2024,11 @@ base_learner* setup(arguments& arg)
   learner<gd,example>& ret = init_learner(g, g->learn, bare->predict, ((uint64_t)1 << arg.all->weights.stride_shift()));
   ret.set_sensitivity(bare->sensitivity);
   ret.set_multipredict(bare->multipredict);
+  ret.set_predict_batch(bare->predict_batch);
   ret.set_update(bare->update);
   ret.set_save_load(save_load);
   ret.set_end_pass(end_pass);
+  ret.set_finish(finish);
   return make_base(ret);
 }
 
@@ -13,6 +13,10 @@
 #include "interactions.h"
 #include "array_parameters.h"
 #include "gd_predict.h"
+#include "floatbits.h"
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#endif
 
 namespace GD
 {
@@ -69,6 +73,27 @@ inline void foreach_feature(vw& all, example& ec, R& dat)
     foreach_feature<R, S, T, dense_parameters>(all.weights.dense_weights, all.ignore_some_linear, all.ignore_linear, all.interactions, all.permutations, ec, dat);
 }
 
+// Touches the linear weights of an example so they are on their way into cache
+// while the one before it in a batch is processed.
+inline void prefetch_weights(vw& all, example& ec, size_t max_features = 128)
+{
+  if (all.weights.sparse) // looking a weight up may insert it
+    return;
+  dense_parameters& weights = all.weights.dense_weights;
+  size_t n = 0;
+  for (features& fs : ec)
+    for (size_t j = 0; j < fs.size(); j++)
+    {
+#ifdef _MSC_VER
+      _mm_prefetch((const char*)&weights[fs.indicies[j] + ec.ft_offset], _MM_HINT_T0);
+#else
+      __builtin_prefetch(&weights[fs.indicies[j] + ec.ft_offset]);
+#endif
+      if (++n == max_features)
+        return;
+    }
+}
+
 // iterate through all namespaces and quadratic&cubic features, callback function T(some_data_R, feature_value_x, feature_weight)
 template <class R, void (*T)(R&, float, float&)>
 inline void foreach_feature(vw& all, example& ec, R& dat)
@@ -80,11 +105,21 @@ inline void foreach_feature(vw& all, example& ec, R& dat)
 
 inline float inline_predict(vw& all, example& ec)
 {
+  if (all.weights.serving_bits == 8)
+    return inline_predict<int8_parameters>(all.weights.int8_weights, all.ignore_some_linear, all.ignore_linear, all.interactions, all.permutations, ec, ec.l.simple.initial);
+  if (all.weights.serving_bits == 16)
+    return inline_predict<fp16_parameters>(all.weights.fp16_weights, all.ignore_some_linear, all.ignore_linear, all.interactions, all.permutations, ec, ec.l.simple.initial);
   return all.weights.sparse ?
     inline_predict<sparse_parameters>(all.weights.sparse_weights, all.ignore_some_linear, all.ignore_linear, all.interactions, all.permutations, ec, ec.l.simple.initial) :
     inline_predict<dense_parameters>(all.weights.dense_weights, all.ignore_some_linear, all.ignore_linear, all.interactions, all.permutations, ec, ec.l.simple.initial);
 }
 
+// With --half_state the adaptive and normalized accumulators of a weight are two bfloat16s in w[1].
+inline float half_adaptive(const weight* w) { return bfloat16_to_float(((const uint16_t*)(w + 1))[0]); }
+inline float half_normalized(const weight* w) { return bfloat16_to_float(((const uint16_t*)(w + 1))[1]); }
+inline void set_half_adaptive(weight* w, float v, uint16_t dither) { ((uint16_t*)(w + 1))[0] = float_to_bfloat16_dithered(v, dither); }
+inline void set_half_normalized(weight* w, float v) { ((uint16_t*)(w + 1))[1] = float_to_bfloat16_up(v); }
+
 inline float sign(float w) { if (w < 0.) return -1.; else  return 1.; }
 
 inline float trunc_weight(const float w, const float gravity)
@@ -59,15 +59,18 @@ void mf_print_offset_features(gdmf& d, example& ec, size_t offset)
         for (features::iterator_all& f1 : ec.feature_space[(unsigned char)i[0]].values_indices_audit())
           for (features::iterator_all& f2 : ec.feature_space[(unsigned char)i[1]].values_indices_audit())
           {
+            // copied out, as a lookup in sparse weights may move the weights of another
+            float w1 = (&weights[f1.index()])[offset + k];
+            float w2 = (&weights[f2.index()])[offset + k + d.rank];
             cout << '\t' << f1.audit().get()->first << k << '^' << f1.audit().get()->second << ':' << ((f1.index() + k)&mask)
                  << "(" << ((f1.index() + offset + k) & mask) << ")" << ':' << f1.value();
-            cout << ':' << (&weights[f1.index()])[offset + k];
+            cout << ':' << w1;
 
             cout << ':' << f2.audit().get()->first << k << '^' << f2.audit().get()->second << ':' << ((f2.index() + k + d.rank)&mask)
                  << "(" << ((f2.index() + offset + k + d.rank) & mask) << ")" << ':' << f2.value();
-            cout << ':' << (&weights[f2.index()])[offset + k + d.rank];
+            cout << ':' << w2;
 
-            cout << ':' << (&weights[f1.index()])[offset + k] * (&weights[f2.index()])[offset + k + d.rank];
+            cout << ':' << w1 * w2;
           }
       }
     }
@@ -22,7 +22,15 @@ namespace GD
   template <class R, void(*T)(R&, const float, float&), class W>
   inline void foreach_feature(W& weights, features& fs, R& dat, uint64_t offset = 0, float mult = 1.)
   {
-    for (features::iterator& f : fs)
+    features::iterator f = fs.begin();
+    const size_t distance = weights.prefetch_distance();
+    if (distance > 0 && fs.size() > distance)
+      for (features::iterator ahead = f + distance; ahead != fs.end(); ++f, ++ahead)
+      {
+        weights.prefetch(ahead.index() + offset);
+        T(dat, mult*f.value(), weights[(f.index() + offset)]);
+      }
+    for (; f != fs.end(); ++f)
       T(dat, mult*f.value(), weights[(f.index() + offset)]);
   }
 
@@ -30,7 +38,16 @@ namespace GD
   template <class R, void(*T)(R&, const float, const float&), class W>
   inline void foreach_feature(const W& weights, features& fs, R& dat, uint64_t offset = 0, float mult = 1.)
   {
-    for (features::iterator& f : fs)
+    features::iterator f = fs.begin();
+    const size_t distance = weights.prefetch_distance();
+    if (distance > 0 && fs.size() > distance)
+      for (features::iterator ahead = f + distance; ahead != fs.end(); ++f, ++ahead)
+      {
+        weights.prefetch(ahead.index() + offset);
+        const weight& w = weights[(f.index() + offset)];
+        T(dat, mult*f.value(), w);
+      }
+    for (; f != fs.end(); ++f)
     {
       const weight& w = weights[(f.index() + offset)];
       T(dat, mult*f.value(), w);
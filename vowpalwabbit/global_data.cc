@@ -301,12 +301,22 @@ vw::vw()
   default_bits = true;
   daemon = false;
   num_children = 10;
+  learn_threads = 1;
+  swap = nullptr;
   save_resume = false;
+  aligned_model = false;
+  model_threads = 0;
+  serving_bits = 8;
+  serving_export = false;
+  deltas = nullptr;
+  checkpoint = nullptr;
   preserve_performance_counters = false;
 
   random_positive_weights = false;
 
   weights.sparse = false;
+  weights.prefetch_distance = 16;
+  weights.serving_bits = 0;
 
   set_minmax = set_mm;
 
@@ -359,6 +369,7 @@ vw::vw()
   normalized_updates = true;
   invariant_updates = true;
   normalized_idx = 2;
+  half_state = false;
 
   add_constant = true;
   audit = false;
@@ -9,6 +9,7 @@ license as described in the file LICENSE.
 #include <iomanip>
 #include <vector>
 #include <map>
+#include <atomic>
 #include <cfloat>
 #include <stdint.h>
 #include <cstdio>
@@ -417,6 +418,9 @@ enum AllReduceType
 };
 
 class AllReduce;
+struct hot_swap;
+struct delta_checkpoint;
+struct background_checkpoint;
 
 // avoid name clash
 namespace label_type
@@ -466,6 +470,8 @@ struct vw
 
   bool daemon;
   size_t num_children;
+  hot_swap* swap; // --hot_swap
+  size_t learn_threads; // --threads: learner threads sharing the weights without locks
 
   bool save_per_pass;
   float initial_weight;
@@ -475,11 +481,18 @@ struct vw
   bool hessian_on;
 
   bool save_resume;
+  bool aligned_model; // --aligned_model: save dense weights as one block a predicting vw can mmap
+  size_t model_threads; // --model_threads: coding the weight chunks of a model, 0 for one per core
+  std::string serving_model_name; // --export_serving_model: also save the weights alone, quantized for vw -t
+  uint32_t serving_bits; // --serving_precision: 8 or 16 bits per weight in the serving model
+  bool serving_export; // while finalize_regressor writes the serving model
+  delta_checkpoint* deltas; // --delta_checkpoints: what the last saved checkpoint held
+  background_checkpoint* checkpoint; // --background_checkpoints
   bool preserve_performance_counters;
   std::string id;
 
   version_struct model_file_ver;
-  double normalized_sum_norm_x;
+  std::atomic<double> normalized_sum_norm_x; // added to by every --threads learner
   bool vw_is_main;  // true if vw is executable; false in library mode
 
   arguments opts_n_args;
@@ -551,6 +564,7 @@ struct vw
   size_t check_holdout_every_n_passes;  // default: 1, but search might want to set it higher if you spend multiple passes learning a single policy
 
   size_t normalized_idx; //offset idx where the norm is stored (1 or 2 depending on whether adaptive is true)
+  bool half_state; // --half_state: the adaptive and normalized state are two bfloat16s in w[1]
 
   uint32_t lda;
 
@@ -0,0 +1,78 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "parse_primitives.h"
+#include "memory.h"
+
+/* Remembers the hashes of recently seen feature names (--hash_cache), so that
+   a name repeated across examples is hashed once.  Each parse thread has its
+   own; entries are looked up by the namespace hash and the bytes of the name
+   in a direct-mapped table, and a miss replaces whatever was in the slot.
+   Names longer than max_name are always hashed. */
+struct hash_cache
+{
+  static const size_t max_name = 44;
+
+  struct entry // one cache line
+  {
+    uint64_t channel_hash;
+    uint64_t hash;
+    uint32_t length; // 0 for an unused entry, names are never empty
+    char name[max_name];
+  };
+
+  entry* entries;
+  uint64_t slot_mask;
+  uint64_t lookups;
+  uint64_t hits;
+
+  hash_cache(size_t size) : lookups(0), hits(0)
+  {
+    size_t slots = 1;
+    while (slots < size)
+      slots *= 2;
+    entries = calloc_or_throw<entry>(slots);
+    slot_mask = slots - 1;
+  }
+
+  ~hash_cache() { free(entries); }
+
+  inline uint64_t slot(const char* name, size_t length, uint64_t channel_hash)
+  { // cheap next to hasher: the first and last 8 bytes, the length and the namespace
+    uint64_t first = 0, last = 0;
+    if (length >= 8)
+    {
+      memcpy(&first, name, 8);
+      memcpy(&last, name + length - 8, 8);
+    }
+    else
+      memcpy(&first, name, length);
+    uint64_t x = first * 0x9E3779B97F4A7C15ULL ^ (last + length) * 0xC2B2AE3D27D4EB4FULL ^ channel_hash;
+    return (x ^ x >> 31 ^ x >> 47) & slot_mask;
+  }
+
+  inline uint64_t hash(hash_func_t hasher, substring name, uint64_t channel_hash)
+  {
+    lookups++;
+    size_t length = name.end - name.begin;
+    if (length > max_name)
+      return hasher(name, channel_hash);
+
+    entry& e = entries[slot(name.begin, length, channel_hash)];
+    if (e.length == length && e.channel_hash == channel_hash && memcmp(e.name, name.begin, length) == 0)
+    {
+      hits++;
+      return e.hash;
+    }
+    e.channel_hash = channel_hash;
+    e.hash = hasher(name, channel_hash);
+    e.length = (uint32_t)length;
+    memcpy(e.name, name.begin, length);
+    return e.hash;
+  }
+};
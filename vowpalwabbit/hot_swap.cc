@@ -0,0 +1,177 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#include <string.h>
+#include <chrono>
+#include <thread>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+#include "hot_swap.h"
+#include "parse_regressor.h"
+#include "vw_exception.h"
+
+//For macs
+#ifndef MAP_ANONYMOUS
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+void init_hot_swap(vw&, size_t) { THROW("--hot_swap is not supported on windows"); }
+void join_hot_swap(vw&, size_t) {}
+bool reload_model(vw&, int*) { return false; }
+#else
+void init_hot_swap(vw& all, size_t children)
+{
+  if (all.weights.sparse)
+    THROW("--hot_swap can't be combined with --sparse_weights");
+  if (!all.opts_n_args.vm.count("initial_regressor"))
+    THROW("--hot_swap reloads the -i model, so it needs one");
+
+  hot_swap* s = new hot_swap();
+  s->model = all.opts_n_args.vm["initial_regressor"].as<vector<string>>()[0];
+  s->children = children;
+  s->slot = nullptr;
+
+  size_t bytes = (all.weights.mask() + 1) * sizeof(weight);
+  s->buffers[0] = all.weights.dense_weights.first();
+  s->buffers[1] = (weight*)mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  size_t control = (children + 1) * sizeof(atomic<weight*>);
+  char* shared = (char*)mmap(0, control, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (s->buffers[1] == MAP_FAILED || shared == MAP_FAILED)
+  {
+    delete s;
+    THROWERRNO("mmap for --hot_swap");
+  }
+  s->active = new (shared) atomic<weight*>(s->buffers[0]);
+  s->busy = (atomic<weight*>*)(shared + sizeof(atomic<weight*>));
+  for (size_t i = 0; i < children; i++)
+    new (&s->busy[i]) atomic<weight*>(nullptr);
+  all.swap = s;
+}
+
+void join_hot_swap(vw& all, size_t i)
+{
+  if (all.swap != nullptr)
+  {
+    all.swap->slot = &all.swap->busy[i];
+    all.swap->slot->store(nullptr); // a child that died in an example may have left it set
+  }
+}
+
+void enter_weights(vw& all)
+{
+  hot_swap& s = *all.swap;
+  weight* w;
+  do
+  { // published before rechecking, so the parent either sees it or this child sees the new buffer
+    w = s.active->load();
+    s.slot->store(w);
+  }
+  while (s.active->load() != w);
+  all.weights.dense_weights.use_shared(w);
+}
+
+void restore_header_state(vw& all, vector<string>& interactions, vector<string>& pairs, vector<string>& triples,
+                          vector<string>& ngram_strings, vector<string>& skip_strings, size_t args, const string& file_options, const string& id)
+{
+  all.interactions.swap(interactions);
+  all.pairs.swap(pairs);
+  all.triples.swap(triples);
+  all.ngram_strings.swap(ngram_strings);
+  all.skip_strings.swap(skip_strings);
+  all.opts_n_args.args.resize(args);
+  all.opts_n_args.file_options->str(file_options);
+  all.id = id;
+}
+
+// the options a model keeps, without the --random_seed of --save_resume, which differs from save to save
+string kept_options(const string& file_options)
+{
+  stringstream in(file_options);
+  string kept, option;
+  while (in >> option)
+    if (option == "--random_seed")
+      in >> option;
+    else
+      kept += " " + option;
+  return kept;
+}
+
+bool reload_model(vw& all, int* children)
+{
+  hot_swap& s = *all.swap;
+  weight* current = s.active->load();
+  weight* target = current == s.buffers[0] ? s.buffers[1] : s.buffers[0];
+
+  // examples that started before the last swap finish on target
+  for (bool waiting = true; waiting;)
+  {
+    waiting = false;
+    for (size_t i = 0; i < s.children; i++)
+      if (s.busy[i].load() == target)
+      {
+        int status;
+        if (children[i] > 0 && waitpid(children[i], &status, WNOHANG) == children[i])
+        {
+          s.busy[i].store(nullptr);
+          children[i] = 0;
+        }
+        else
+          waiting = true;
+      }
+    if (waiting)
+      this_thread::sleep_for(chrono::milliseconds(1));
+  }
+
+  dense_parameters& weights = all.weights.dense_weights;
+  uint32_t num_bits = all.num_bits;
+  // reading a header sets these, which the running learners were set up with: the model must
+  // agree with them, and they are put back either way
+  vector<string> interactions, pairs, triples, ngram_strings, skip_strings;
+  interactions.swap(all.interactions);
+  pairs.swap(all.pairs);
+  triples.swap(all.triples);
+  ngram_strings.swap(all.ngram_strings);
+  skip_strings.swap(all.skip_strings);
+  size_t args = all.opts_n_args.args.size();
+  string file_options = all.opts_n_args.file_options->str();
+  string id = all.id;
+  weights.use_shared(target);
+  try
+  {
+    memset(target, 0, (weights.mask() + 1) * sizeof(weight));
+    io_buf model;
+    model.open_file(s.model.c_str(), false, io_buf::READ);
+    save_load_header(all, model, true, false);
+    if (all.num_bits != num_bits)
+      THROW("the model has " << all.num_bits << " bits where " << num_bits << " are in use");
+    // current models keep their interactions among the options, older ones in the header
+    if (kept_options(all.opts_n_args.file_options->str()) != kept_options(file_options))
+      THROW("the model was trained with the options '" << all.opts_n_args.file_options->str() << "' where '" << file_options << "' are in use");
+    if (!all.interactions.empty() && all.interactions != interactions)
+      THROW("the model was trained with other interactions than those in use");
+    all.l->save_load(model, true, false);
+    model.close_file();
+    restore_header_state(all, interactions, pairs, triples, ngram_strings, skip_strings, args, file_options, id);
+  }
+  catch (exception& e)
+  {
+    restore_header_state(all, interactions, pairs, triples, ngram_strings, skip_strings, args, file_options, id);
+    all.num_bits = num_bits;
+    weights.use_shared(current);
+    all.opts_n_args.trace_message << "keeping the current model, reloading " << s.model << " failed: " << e.what() << endl;
+    return false;
+  }
+
+  s.active->store(target);
+  if (!all.quiet)
+    all.opts_n_args.trace_message << "swapped in " << s.model << endl;
+  return true;
+}
+#endif
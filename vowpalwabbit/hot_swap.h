@@ -0,0 +1,46 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#pragma once
+#include <atomic>
+#include <string>
+#include "global_data.h"
+
+/* --hot_swap: a daemon reloads its -i model on SIGHUP while the children keep
+   their connections.  The parent shares two weight buffers with the children
+   and loads the new model into the one no example is using, then makes it
+   the active one; each child moves to the active buffer as it starts an
+   example, so an example sees one model from start to finish. */
+struct hot_swap
+{
+  std::string model;            // the -i file
+  weight* buffers[2];           // shared
+  std::atomic<weight*>* active; // shared: the weights an example starts with
+  std::atomic<weight*>* busy;   // shared, one per child: the weights of its example in progress, nullptr between examples
+  size_t children;
+  std::atomic<weight*>* slot;   // this child's entry in busy, nullptr in the parent
+};
+
+//called by the daemon parent once its weights are shared, before the children fork
+void init_hot_swap(vw& all, size_t children);
+//called in child i right after the fork
+void join_hot_swap(vw& all, size_t i);
+//loads the model into the inactive buffer and activates it; children that die while it waits for them are reaped and their pid set to 0
+bool reload_model(vw& all, int* children);
+
+void enter_weights(vw& all);
+
+//brackets the learning of each example or batch of examples in a daemon child
+inline void hot_swap_enter(vw& all)
+{
+  if (all.swap != nullptr && all.swap->slot != nullptr)
+    enter_weights(all);
+}
+
+inline void hot_swap_leave(vw& all)
+{
+  if (all.swap != nullptr && all.swap->slot != nullptr)
+    all.swap->slot->store(nullptr);
+}
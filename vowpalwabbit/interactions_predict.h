@@ -26,6 +26,7 @@ namespace INTERACTIONS
 #define PROCESS_SELF_INTERACTIONS(ft_value) feature_self_interactions
 
   // 3 template functions to pass T() proper argument (feature idx in regressor, or its coefficient)
+  // and 3 to say whether T() reads the weight, so that the kernels prefetch it
 
   template <class R, void(*T)(R&, const float, float&), class W>
   inline void call_T(R& dat, W& weights, const float ft_value, const uint64_t ft_idx)
@@ -45,6 +46,15 @@ namespace INTERACTIONS
     T(dat, ft_value, ft_idx);
   }
 
+  template <class R, void(*T)(R&, const float, float&), class W>
+  inline size_t prefetch_distance(const W& weights) { return weights.prefetch_distance(); }
+
+  template <class R, void(*T)(R&, const float, const float&), class W>
+  inline size_t prefetch_distance(const W& weights) { return weights.prefetch_distance(); }
+
+  template <class R, void(*T)(R&, float, uint64_t), class W>
+  inline size_t prefetch_distance(const W& /*weights*/) { return 0; }
+
   // state data used in non-recursive feature generation algorithm
   // contains N feature_gen_data records (where N is length of interaction)
   struct feature_gen_data
@@ -59,6 +69,21 @@ namespace INTERACTIONS
     //    feature_gen_data(): loop_idx(0), x(1.), loop_end(0), self_interaction(false) {}
   };
 
+  // state data of the generic algorithm kept by each thread from call to call,
+  // so generating the interactions of an example doesn't allocate
+  struct generation_scratch
+  {
+    v_array<feature_gen_data> state_data;
+    generation_scratch() : state_data(v_init<feature_gen_data>()) {}
+    ~generation_scratch() { state_data.delete_v(); }
+  };
+
+  inline v_array<feature_gen_data>& state_data_scratch()
+  {
+    static thread_local generation_scratch scratch;
+    return scratch.state_data;
+  }
+
   // The inline function below may be adjusted to change the way
   // synthetic (interaction) features' values are calculated, e.g.,
   // fabs(value1-value2) or even value1>value2?1.0:-1.0
@@ -83,13 +108,230 @@ namespace INTERACTIONS
       }
     }
     else
-    {
+    { // the weights are hashed apart, so each would be a cache miss without looking ahead
+      const size_t distance = prefetch_distance<R, T>(weights);
+      if (distance > 0 && (size_t)(end - begin) > distance)
+        for (features::iterator_all ahead = begin + distance; ahead != end; ++begin, ++ahead)
+        {
+          weights.prefetch((ahead.index() ^ halfhash) + offset);
+          call_T<R, T>(dat, weights, INTERACTION_VALUE(ft_value, begin.value()), (begin.index() ^ halfhash) + offset);
+        }
       for (; begin != end; ++begin)
         call_T<R, T>(dat, weights, INTERACTION_VALUE(ft_value, begin.value()), (begin.index() ^ halfhash) + offset);
     }
   }
 
 
+  // the nested 'for' loops of an interaction of 4 namespaces, kept out of generate_interactions so it stays small
+  template <class R, class S, void(*T)(R&, float, S), bool audit, void(*audit_func)(R&, const audit_strings*), class W>
+  inline void generate_quadruples(const std::string& ns, bool permutations, features* features_data, const uint64_t offset, R& dat, W& weights)
+  {
+    features& first = features_data[(uint8_t)ns[0]];
+    features& second = features_data[(uint8_t)ns[1]];
+    features& third = features_data[(uint8_t)ns[2]];
+    features& fourth = features_data[(uint8_t)ns[3]];
+    if (first.nonempty() && second.nonempty() && third.nonempty() && fourth.nonempty())
+    { // as for triples only neighbours can be the same namespace
+      const bool same_namespace1 = (!permutations && (ns[0] == ns[1]));
+      const bool same_namespace2 = (!permutations && (ns[1] == ns[2]));
+      const bool same_namespace3 = (!permutations && (ns[2] == ns[3]));
+
+      for (size_t i = 0; i < first.indicies.size(); ++i)
+      {
+        if (audit) audit_func(dat, first.space_names[i].get());
+        const uint64_t halfhash1 = FNV_prime * (uint64_t)first.indicies[i];
+        const float& first_ft_value = first.values[i];
+        size_t j = 0;
+        if (same_namespace1)
+          j = (PROCESS_SELF_INTERACTIONS(first_ft_value)) ? i : i + 1;
+
+        for (; j < second.indicies.size(); ++j)
+        {
+          if (audit) audit_func(dat, second.space_names[j].get());
+          const uint64_t halfhash2 = FNV_prime * (halfhash1 ^ (uint64_t)second.indicies[j]);
+          const feature_value second_ft_value = INTERACTION_VALUE(first_ft_value, second.values[j]);
+          size_t k = 0;
+          if (same_namespace2)
+            k = (PROCESS_SELF_INTERACTIONS(second_ft_value)) ? j : j + 1;
+
+          for (; k < third.indicies.size(); ++k)
+          { //f4 x k*(f3 x k*(f2 x k*f1))
+            if (audit) audit_func(dat, third.space_names[k].get());
+            feature_index halfhash = FNV_prime * (halfhash2 ^ (uint64_t)third.indicies[k]);
+            feature_value ft_value = INTERACTION_VALUE(second_ft_value, third.values[k]);
+
+            features::features_value_index_audit_range range = fourth.values_indices_audit();
+            features::iterator_all begin = range.begin();
+            if (same_namespace3)
+              begin += (PROCESS_SELF_INTERACTIONS(ft_value)) ? k : k + 1;
+
+            features::iterator_all end = range.end();
+            inner_kernel<R, S, T, audit, audit_func>(dat, begin, end, offset, weights, ft_value, halfhash);
+            if (audit) audit_func(dat, nullptr);
+          } // end for (thr)
+          if (audit) audit_func(dat, nullptr);
+        } // end for (snd)
+        if (audit) audit_func(dat, nullptr);
+      } // end for (fst)
+    } // end if all four namespaces have features
+  }
+
+  // the generic non-recursive algorithm for an interaction of any length
+  template <class R, class S, void(*T)(R&, float, S), bool audit, void(*audit_func)(R&, const audit_strings*), class W>
+  inline void generate_generic_interaction(const std::string& ns, bool permutations, features* features_data, const uint64_t offset, R& dat, W& weights)
+  {
+    // statedata for generic non-recursive iteration
+    v_array<feature_gen_data>& state_data = state_data_scratch();
+
+    feature_gen_data empty_ns_data;  // micro-optimization. don't want to call its constructor each time in loop.
+    empty_ns_data.loop_idx = 0;
+    empty_ns_data.x = 1.;
+    empty_ns_data.loop_end = 0;
+    empty_ns_data.self_interaction = false;
+
+    bool must_skip_interaction = false;
+    // preparing state data, one record per namespace of this interaction
+    state_data.end() = state_data.begin();
+    feature_gen_data* fgd;
+    feature_gen_data* fgd2; // for further use
+    for (namespace_index n : ns)
+    {
+      features& ft = features_data[(int32_t)n];
+      const size_t ft_cnt = ft.indicies.size();
+
+      if (ft_cnt == 0)
+      {
+        must_skip_interaction = true;
+        break;
+      }
+
+      state_data.push_back(empty_ns_data); // allocates only the first time a thread sees an interaction this long
+      fgd = state_data.end() - 1;
+      fgd->loop_end = ft_cnt - 1; // saving number of features for each namespace
+      fgd->ft_arr = &ft;
+    }
+
+    // if any of interacting namespace has 0 features - whole interaction is skipped
+    if (must_skip_interaction) return; //no_data_to_interact
+
+    if (!permutations) // adjust state_data for simple combinations
+    { // if permutations mode is disabeled then namespaces in ns are already sorted and thus grouped
+      // (in fact, currently they are sorted even for enabled permutations mode)
+      // let's go throw the list and calculate number of features to skip in namespaces which
+      // repeated more than once to generate only simple combinations of features
+
+      size_t margin = 0;  // number of features to ignore if namespace has been seen before
+
+                          // iterate list backward as margin grows in this order
+
+      for (fgd = state_data.end() - 1; fgd > state_data.begin(); --fgd)
+      {
+        fgd2 = fgd - 1;
+        fgd->self_interaction = (fgd->ft_arr == fgd2->ft_arr); //state_data.begin().self_interaction is always false
+        if (fgd->self_interaction)
+        {
+          size_t& loop_end = fgd2->loop_end;
+
+          if (!PROCESS_SELF_INTERACTIONS((*fgd2->ft_arr).values[loop_end - margin]))
+          {
+            ++margin; // otherwise margin can't be increased
+            if ((must_skip_interaction = (loop_end < margin))) break;
+          }
+
+          if (margin != 0)
+            loop_end -= margin;               // skip some features and increase margin
+        }
+        else if (margin != 0) margin = 0;
+      }
+
+      // if impossible_without_permutations == true then we faced with case like interaction 'aaaa'
+      // where namespace 'a' contains less than 4 unique features. It's impossible to make simple
+      // combination of length 4 without repetitions from 3 or less elements.
+      if (must_skip_interaction) return; // impossible_without_permutations
+    } // end of state_data adjustment
+
+
+    fgd = state_data.begin();  // always equal to first ns
+    fgd2 = state_data.end() - 1; // always equal to last ns
+    fgd->loop_idx = 0; // loop_idx contains current feature id for curently processed namespace.
+
+                       // beware: micro-optimization.
+                       /* start & end are always point to features in last namespace of interaction.
+                       for 'all.permutations == true' they are constant.*/
+    size_t start_i = 0;
+
+    feature_gen_data* cur_data = fgd;
+    // end of micro-optimization block
+
+    // generic feature generation cycle for interactions of any length
+    bool do_it = true;
+    while (do_it)
+    {
+      if (cur_data < fgd2) // can go further threw the list of namespaces in interaction
+      {
+        feature_gen_data* next_data = cur_data + 1;
+        size_t feature = cur_data->loop_idx;
+        features& fs = *(cur_data->ft_arr);
+
+        if (next_data->self_interaction)
+        { // if next namespace is same, we should start with loop_idx + 1 to avoid feature interaction with itself
+          // unless feature has value x and x != x*x. E.g. x != 0 and x != 1. Features with x == 0 are already
+          // filtered out in parce_args.cc::maybeFeature().
+
+          next_data->loop_idx = (PROCESS_SELF_INTERACTIONS(fs.values[feature])) ? cur_data->loop_idx : cur_data->loop_idx + 1;
+        }
+        else
+          next_data->loop_idx = 0;
+
+        if (audit) audit_func(dat, fs.space_names[feature].get());
+
+        if (cur_data == fgd) // first namespace
+        {
+          next_data->hash = FNV_prime * (uint64_t)fs.indicies[feature];
+          next_data->x = fs.values[feature]; // data->x == 1.
+        }
+        else
+        { // feature2 xor (16777619*feature1)
+          next_data->hash = FNV_prime * (cur_data->hash ^ (uint64_t)fs.indicies[feature]);
+          next_data->x = INTERACTION_VALUE(fs.values[feature], cur_data->x);
+        }
+
+        ++cur_data;
+      }
+      else
+      { // last namespace - iterate its features and go back
+        if (!permutations) // start value is not a constant in this case
+          start_i = fgd2->loop_idx;
+
+        features& fs = *(fgd2->ft_arr);
+
+        feature_value ft_value = fgd2->x;
+        feature_index halfhash = fgd2->hash;
+
+        features::features_value_index_audit_range range = fs.values_indices_audit();
+        features::iterator_all begin = range.begin();
+        begin += start_i;
+        features::iterator_all end = range.begin();
+        end += fgd2->loop_end + 1;
+        inner_kernel<R, S, T, audit, audit_func, W>(dat, begin, end, offset, weights, ft_value, halfhash);
+
+        // trying to go back increasing loop_idx of each namespace by the way
+
+        bool go_further = true;
+
+        do
+        {
+          --cur_data;
+          go_further = (++cur_data->loop_idx > cur_data->loop_end); //increment loop_idx
+          if (audit) audit_func(dat, nullptr);
+        } while (go_further && cur_data != fgd);
+
+        do_it = !(cur_data == fgd && go_further);
+        //if do_it==false - we've reached 0 namespace but its 'cur_data.loop_idx > cur_data.loop_end' -> exit the while loop
+      } // if last namespace
+    } // while do_it
+  }
+
   // this templated function generates new features for given example and set of interactions
   // and passes each of them to given function T()
   // it must be in header file to avoid compilation problems
@@ -102,23 +344,14 @@ namespace INTERACTIONS
     const uint64_t offset = ec.ft_offset;
     //    const uint64_t stride_shift = all.stride_shift; // it seems we don't need stride shift in FTRL-like hash
 
-    // statedata for generic non-recursive iteration
-    v_array<feature_gen_data > state_data = v_init<feature_gen_data >();
-
-    feature_gen_data empty_ns_data;  // micro-optimization. don't want to call its constructor each time in loop.
-    empty_ns_data.loop_idx = 0;
-    empty_ns_data.x = 1.;
-    empty_ns_data.loop_end = 0;
-    empty_ns_data.self_interaction = false;
-
     // loop throw the set of possible interactions
     for (auto& ns : interactions)
     { // current list of namespaces to interact.
 
 #ifndef GEN_INTER_LOOP
 
-      // unless GEN_INTER_LOOP is defined we use nested 'for' loops for interactions length 2 (pairs) and 3 (triples)
-      // and generic non-recursive algorythm for all other cases.
+      // unless GEN_INTER_LOOP is defined we use nested 'for' loops for interactions length 2 (pairs), 3 (triples)
+      // and 4 (quadruples) and generic non-recursive algorythm for all other cases.
       // nested 'for' loops approach is faster, but can't be used for interation of any length.
 
       const size_t len = ns.size();
@@ -198,159 +431,12 @@ namespace INTERACTIONS
         } // end if (data[fst] size > 0)
 
       }
-      else   // generic case: quatriples, etc.
+      else if (len == 4) // special case for quadruples
+        generate_quadruples<R, S, T, audit, audit_func, W>(ns, permutations, features_data, offset, dat, weights);
+      else   // generic case: 5 and more namespaces
 
 #endif
-      {
-
-        bool must_skip_interaction = false;
-        // preparing state data
-        feature_gen_data* fgd = state_data.begin();
-        feature_gen_data* fgd2; // for further use
-        for (namespace_index n : ns)
-        {
-          features& ft = features_data[(int32_t)n];
-          const size_t ft_cnt = ft.indicies.size();
-
-          if (ft_cnt == 0)
-          {
-            must_skip_interaction = true;
-            break;
-          }
-
-          if (fgd == state_data.end())
-          {
-            state_data.push_back(empty_ns_data);
-            fgd = state_data.end() - 1; // reassign as memory could be realloced
-          }
-
-          fgd->loop_end = ft_cnt - 1; // saving number of features for each namespace
-          fgd->ft_arr = &ft;
-          ++fgd;
-        }
-
-        // if any of interacting namespace has 0 features - whole interaction is skipped
-        if (must_skip_interaction) continue; //no_data_to_interact
-
-        if (!permutations) // adjust state_data for simple combinations
-        { // if permutations mode is disabeled then namespaces in ns are already sorted and thus grouped
-          // (in fact, currently they are sorted even for enabled permutations mode)
-          // let's go throw the list and calculate number of features to skip in namespaces which
-          // repeated more than once to generate only simple combinations of features
-
-          size_t margin = 0;  // number of features to ignore if namespace has been seen before
-
-                              // iterate list backward as margin grows in this order
-
-          for (fgd = state_data.end() - 1; fgd > state_data.begin(); --fgd)
-          {
-            fgd2 = fgd - 1;
-            fgd->self_interaction = (fgd->ft_arr == fgd2->ft_arr); //state_data.begin().self_interaction is always false
-            if (fgd->self_interaction)
-            {
-              size_t& loop_end = fgd2->loop_end;
-
-              if (!PROCESS_SELF_INTERACTIONS((*fgd2->ft_arr).values[loop_end - margin]))
-              {
-                ++margin; // otherwise margin can't be increased
-                if ((must_skip_interaction = (loop_end < margin))) break;
-              }
-
-              if (margin != 0)
-                loop_end -= margin;               // skip some features and increase margin
-            }
-            else if (margin != 0) margin = 0;
-          }
-
-          // if impossible_without_permutations == true then we faced with case like interaction 'aaaa'
-          // where namespace 'a' contains less than 4 unique features. It's impossible to make simple
-          // combination of length 4 without repetitions from 3 or less elements.
-          if (must_skip_interaction) continue; // impossible_without_permutations
-        } // end of state_data adjustment
-
-
-        fgd = state_data.begin();  // always equal to first ns
-        fgd2 = state_data.end() - 1; // always equal to last ns
-        fgd->loop_idx = 0; // loop_idx contains current feature id for curently processed namespace.
-
-                           // beware: micro-optimization.
-                           /* start & end are always point to features in last namespace of interaction.
-                           for 'all.permutations == true' they are constant.*/
-        size_t start_i = 0;
-
-        feature_gen_data* cur_data = fgd;
-        // end of micro-optimization block
-
-        // generic feature generation cycle for interactions of any length
-        bool do_it = true;
-        while (do_it)
-        {
-          if (cur_data < fgd2) // can go further threw the list of namespaces in interaction
-          {
-            feature_gen_data* next_data = cur_data + 1;
-            size_t feature = cur_data->loop_idx;
-            features& fs = *(cur_data->ft_arr);
-
-            if (next_data->self_interaction)
-            { // if next namespace is same, we should start with loop_idx + 1 to avoid feature interaction with itself
-              // unless feature has value x and x != x*x. E.g. x != 0 and x != 1. Features with x == 0 are already
-              // filtered out in parce_args.cc::maybeFeature().
-
-              next_data->loop_idx = (PROCESS_SELF_INTERACTIONS(fs.values[feature])) ? cur_data->loop_idx : cur_data->loop_idx + 1;
-            }
-            else
-              next_data->loop_idx = 0;
-
-            if (audit) audit_func(dat, fs.space_names[feature].get());
-
-            if (cur_data == fgd) // first namespace
-            {
-              next_data->hash = FNV_prime * (uint64_t)fs.indicies[feature];
-              next_data->x = fs.values[feature]; // data->x == 1.
-            }
-            else
-            { // feature2 xor (16777619*feature1)
-              next_data->hash = FNV_prime * (cur_data->hash ^ (uint64_t)fs.indicies[feature]);
-              next_data->x = INTERACTION_VALUE(fs.values[feature], cur_data->x);
-            }
-
-            ++cur_data;
-          }
-          else
-          { // last namespace - iterate its features and go back
-            if (!permutations) // start value is not a constant in this case
-              start_i = fgd2->loop_idx;
-
-            features& fs = *(fgd2->ft_arr);
-
-            feature_value ft_value = fgd2->x;
-            feature_index halfhash = fgd2->hash;
-
-            features::features_value_index_audit_range range = fs.values_indices_audit();
-            features::iterator_all begin = range.begin();
-            begin += start_i;
-            features::iterator_all end = range.begin();
-            end += fgd2->loop_end + 1;
-            inner_kernel<R, S, T, audit, audit_func, W>(dat, begin, end, offset, weights, ft_value, halfhash);
-
-            // trying to go back increasing loop_idx of each namespace by the way
-
-            bool go_further = true;
-
-            do
-            {
-              --cur_data;
-              go_further = (++cur_data->loop_idx > cur_data->loop_end); //increment loop_idx
-              if (audit) audit_func(dat, nullptr);
-            } while (go_further && cur_data != fgd);
-
-            do_it = !(cur_data == fgd && go_further);
-            //if do_it==false - we've reached 0 namespace but its 'cur_data.loop_idx > cur_data.loop_end' -> exit the while loop
-          } // if last namespace
-        } // while do_it
-      }
+        generate_generic_interaction<R, S, T, audit, audit_func, W>(ns, permutations, features_data, offset, dat, weights);
     } // foreach interaction in all.interactions
-
-    state_data.delete_v();
   }
 } // end of namespace
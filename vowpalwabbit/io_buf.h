@@ -135,6 +135,32 @@ public:
     head = space.begin();
   }
 
+  // reposition file f like lseek and drop whatever is buffered; returns the new offset or -1
+  virtual int64_t seek_file(int f, int64_t offset, int whence)
+  {
+#ifdef _WIN32
+    int64_t ret = _lseeki64(f, offset, whence);
+#else
+    int64_t ret = lseek(f, offset, whence);
+#endif
+    space.end() = space.begin();
+    head = space.begin();
+    return ret;
+  }
+
+  // the offset in file f of head: after the bytes written to space, or before the bytes read into it that haven't been consumed.  -1 when f can't seek.
+  int64_t tell_file(int f, bool writing)
+  {
+#ifdef _WIN32
+    int64_t ret = _lseeki64(f, 0, SEEK_CUR);
+#else
+    int64_t ret = lseek(f, 0, SEEK_CUR);
+#endif
+    if (ret < 0)
+      return -1;
+    return writing ? ret + (head - space.begin()) : ret - (space.end() - head);
+  }
+
   io_buf()
   { init();
   }
@@ -154,7 +180,7 @@ public:
 
   static ssize_t read_file_or_socket(int f, void* buf, size_t nbytes);
 
-  ssize_t fill(int f)
+  virtual ssize_t fill(int f)
   { // if the loaded values have reached the allocated space
     if (space.end_array - space.end() == 0)
     { // reallocate to twice as much space
@@ -173,6 +199,14 @@ public:
       return 0;
   }
 
+  // move the unread values [head, space.end) down to space.begin to make room for fill
+  virtual void shift()
+  { size_t left = space.end() - head;
+    memmove(space.begin(), head, left);
+    head = space.begin();
+    space.end() = space.begin() + left;
+  }
+
   virtual ssize_t write_file(int f, const void* buf, size_t nbytes)
   { return write_file_or_socket(f, buf, nbytes); }
 
@@ -2,11 +2,17 @@
 #include "vw.h"
 #include "parse_regressor.h"
 #include "parse_dispatch_loop.h"
+#include "hot_swap.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
 using namespace std;
 
 void dispatch_example(vw& all, example& ec)
 {
+  hot_swap_enter(all);
   all.learn(ec);
+  hot_swap_leave(all);
   as_singleline(all.l)->finish_example(all, ec);
 }
 
@@ -37,7 +43,9 @@ namespace LEARNER
 void dispatch_end_pass(vw& all, example& ec)
 {
   all.current_pass++;
+  hot_swap_enter(all);
   all.l->end_pass();
+  hot_swap_leave(all);
   VW::finish_example(all, ec);
 }
 
@@ -51,7 +59,9 @@ void save(vw& all, example* ec)
 
   if (!all.quiet)
     all.opts_n_args.trace_message << "saving regressor to " << final_regressor_name << endl;
+  hot_swap_enter(all);
   save_predictor(all, final_regressor_name, 0);
+  hot_swap_leave(all);
 
   VW::finish_example(all,*ec);
 }
@@ -73,9 +83,55 @@ void process_example(vw& all, example* ec)
     dispatch_example(all, *ec);
 }
 
+// Predicting, the examples between a pass end or save command can go to the
+// learner as one batch and be finished afterwards: nothing a prediction reads
+// changes in finish_example.  Audit and raw predictions print from inside
+// predict, so they keep the one example at a time order of the output.
+const size_t max_batch = 32;
+
+bool batch_predictions(vw& all)
+{
+  return !all.training && !all.audit && !all.hash_inv && all.raw_prediction == -1
+         && as_singleline(all.l)->has_predict_batch();
+}
+
+inline bool is_control(example* ec)
+{
+  return ec->indices.size() <= 1 && (ec->end_pass || is_save_cmd(ec));
+}
+
+void process_examples(vw& all, example** ecs, size_t count)
+{
+  single_learner& l = *as_singleline(all.l);
+  for (size_t i = 0; i < count;)
+  {
+    if (is_control(ecs[i]))
+    {
+      process_example(all, ecs[i++]);
+      if (all.early_terminate) // the rest are drained, as generic_driver does
+      {
+        for (; i < count; i++)
+          VW::finish_example(all, *ecs[i]);
+        return;
+      }
+      continue;
+    }
+    size_t end = i + 1;
+    while (end < count && !is_control(ecs[end]))
+      end++;
+    hot_swap_enter(all);
+    l.predict_batch(ecs + i, end - i);
+    hot_swap_leave(all);
+    for (; i < end; i++)
+      l.finish_example(all, *ecs[i]);
+  }
+}
+
 void process_multi_ex(vw& all, multi_ex& ec_seq)
 {
+  hot_swap_enter(all);
   all.learn(ec_seq);
+  hot_swap_leave(all);
   as_multiline(all.l)->finish_example(all, ec_seq);
 }
 
@@ -195,10 +251,156 @@ void generic_driver(vector<vw*> alls)
     (*it)->l->end_examples();
 }
 
+void batch_driver(vw& all)
+{
+  example* ecs[max_batch];
+  size_t count;
+
+  while ( all.early_terminate == false )
+    if ((count = VW::get_examples(all.p, ecs, max_batch)) > 0)
+      process_examples(all, ecs, count);
+    else
+      break;
+  if (all.early_terminate) //drain any extra examples from parser.
+  { example* ec;
+    while ((ec = VW::get_example(all.p)) != nullptr)
+      VW::finish_example(all, *ec);
+  }
+  all.l->end_examples();
+}
+
+/* --threads: each learner thread takes examples from the ring and learns them
+   through the scorer and gd while the others do the same, with no locking
+   around the weights (hogwild).  The progress counters of shared_data are
+   kept per thread and merged at most flush_interval examples apart, so gd
+   sees a t that lags by that much.  Predictions are written as examples
+   finish, which need not be input order.  A pass end or save command waits
+   until every example taken before it has been learned. */
+const size_t flush_interval = 64;
+
+struct hogwild
+{
+  vw* all;
+  mutex take_lock;  // taking from the ring, and everything a pass end or save does
+  mutex stats_lock; // all.sd and prediction output
+  uint64_t taken;   // under take_lock
+  atomic<uint64_t> learned;
+  vector<shared_data*> counters; // per thread, since its last flush
+};
+
+void merge_counters(shared_data& into, shared_data& from)
+{
+  into.t += from.t;
+  into.example_number += from.example_number;
+  into.total_features += from.total_features;
+  into.weighted_labeled_examples += from.weighted_labeled_examples;
+  into.weighted_unlabeled_examples += from.weighted_unlabeled_examples;
+  into.weighted_labels += from.weighted_labels;
+  into.sum_loss += from.sum_loss;
+  into.sum_loss_since_last_dump += from.sum_loss_since_last_dump;
+  into.weighted_holdout_examples += from.weighted_holdout_examples;
+  into.weighted_holdout_examples_since_last_dump += from.weighted_holdout_examples_since_last_dump;
+  into.weighted_holdout_examples_since_last_pass += from.weighted_holdout_examples_since_last_pass;
+  into.holdout_sum_loss += from.holdout_sum_loss;
+  into.holdout_sum_loss_since_last_dump += from.holdout_sum_loss_since_last_dump;
+  into.holdout_sum_loss_since_last_pass += from.holdout_sum_loss_since_last_pass;
+  memset(&from, 0, sizeof(from));
+}
+
+void learn_hogwild(hogwild& h, shared_data& counters, size_t& unflushed, example& ec)
+{
+  vw& all = *h.all;
+  all.learn(ec);
+
+  label_data& ld = ec.l.simple;
+  counters.update(ec.test_only, ld.label != FLT_MAX, ec.loss, ec.weight, ec.num_features);
+  if (ld.label != FLT_MAX && !ec.test_only)
+    counters.weighted_labels += ((double)ld.label) * ec.weight;
+
+  // the shared total is read without the lock; it only decides when to flush
+  bool flush = ++unflushed == flush_interval
+               || all.sd->weighted_examples() + counters.weighted_examples() >= all.sd->dump_interval;
+  if (flush || all.raw_prediction > 0 || all.final_prediction_sink.size() > 0)
+  {
+    lock_guard<mutex> lock(h.stats_lock);
+    all.print(all.raw_prediction, ec.partial_prediction, -1, ec.tag);
+    for (size_t i = 0; i < all.final_prediction_sink.size(); i++)
+      all.print((int)all.final_prediction_sink[i], ec.pred.scalar, 0, ec.tag);
+    if (flush)
+    {
+      merge_counters(*all.sd, counters);
+      unflushed = 0;
+      print_update(all, ec);
+    }
+  }
+}
+
+void hogwild_thread(hogwild& h, shared_data& counters)
+{
+  vw& all = *h.all;
+  size_t unflushed = 0;
+  while (true)
+  {
+    unique_lock<mutex> take(h.take_lock);
+    example* ec = VW::get_example(all.p);
+    if (ec == nullptr)
+      break;
+    uint64_t index = h.taken++;
+
+    if (all.early_terminate)
+      VW::finish_example(all, *ec);
+    else if (is_control(ec))
+    { // with take_lock held nobody starts another example
+      while (h.learned.load(memory_order_acquire) != index)
+        this_thread::yield();
+      {
+        lock_guard<mutex> lock(h.stats_lock);
+        for (shared_data* c : h.counters)
+          merge_counters(*all.sd, *c);
+      }
+      process_example(all, ec);
+    }
+    else
+    {
+      take.unlock();
+      learn_hogwild(h, counters, unflushed, *ec);
+      VW::finish_example(all, *ec);
+    }
+    h.learned.fetch_add(1, memory_order_release);
+  }
+}
+
+void hogwild_driver(vw& all)
+{
+  hogwild h;
+  h.all = &all;
+  h.taken = 0;
+  h.learned = 0;
+  for (size_t i = 0; i < all.learn_threads; i++)
+    h.counters.push_back(&calloc_or_throw<shared_data>());
+
+  vector<thread> threads;
+  for (size_t i = 0; i < all.learn_threads; i++)
+    threads.push_back(thread(hogwild_thread, ref(h), ref(*h.counters[i])));
+  for (thread& t : threads)
+    t.join();
+
+  for (shared_data* c : h.counters)
+  {
+    merge_counters(*all.sd, *c);
+    free(c);
+  }
+  all.l->end_examples();
+}
+
 void generic_driver(vw& all)
 {
   if(all.l->is_multiline)
     multi_ex_generic_driver<process_multi_ex>(all);
+  else if (all.learn_threads > 1)
+    hogwild_driver(all);
+  else if (batch_predictions(all))
+    batch_driver(all);
   else
     generic_driver<vw&, process_example>(all, all);
 
@@ -207,6 +409,12 @@ void generic_driver(vw& all)
 void dispatch(vw& all, v_array<example*> examples)
 {
   all.p->end_parsed_examples+=examples.size(); //divergence: lock & signal
+  if (batch_predictions(all))
+  {
+    for (size_t i = 0; i < examples.size(); i += max_batch)
+      process_examples(all, examples.begin() + i, min(max_batch, examples.size() - i));
+    return;
+  }
   for (size_t i = 0; i < examples.size(); ++i)
     process_example(all, examples[i]);
 }
@@ -53,6 +53,7 @@ inline func_data tuple_dbf(void* data, base_learner* base, void (*func)(void*))
 struct learn_data
 { using fn = void(*)(void* data, base_learner& base, void* ex);
   using multi_fn = void(*)(void* data, base_learner& base, void* ex, size_t count, size_t step, polyprediction*pred, bool finalize_predictions);
+  using batch_fn = void(*)(void* data, base_learner& base, void* ecs, size_t count);
 
   void* data;
   base_learner* base;
@@ -60,6 +61,7 @@ struct learn_data
   fn predict_f;
   fn update_f;
   multi_fn multipredict_f;
+  batch_fn predict_batch_f;
 };
 
 struct sensitivity_data
@@ -172,12 +174,39 @@ public:
     }
   }
 
+  //learn or predict count examples in order, as count calls to learn or predict would.
+  //Learning always loops, since the drivers only batch predictions; so do reductions without a predict_batch.
+  inline void learn_batch(E** ecs, size_t count, size_t i = 0)
+  { for (size_t e = 0; e < count; e++)
+      learn(*ecs[e], i);
+  }
+
+  inline void predict_batch(E** ecs, size_t count, size_t i = 0)
+  { if (learn_fd.predict_batch_f == nullptr)
+    { for (size_t e = 0; e < count; e++)
+        predict(*ecs[e], i);
+      return;
+    }
+    for (size_t e = 0; e < count; e++)
+      increment_offset(*ecs[e], increment, i);
+    learn_fd.predict_batch_f(learn_fd.data, *learn_fd.base, (void*)ecs, count);
+    for (size_t e = 0; e < count; e++)
+      decrement_offset(*ecs[e], increment, i);
+  }
+
+  inline bool has_predict_batch() { return learn_fd.predict_batch_f != nullptr; }
+
+  //the learner this one reduces to, nullptr for a base learner
+  inline base_learner* get_learn_base() { return learn_fd.base; }
+
   template<class L>
   inline void set_predict(void (*u)(T&, L&, E&)) { learn_fd.predict_f = (learn_data::fn)u; }
   template<class L>
   inline void set_learn(void (*u)(T&, L&, E&)) { learn_fd.learn_f = (learn_data::fn)u; }
   template<class L>
   inline void set_multipredict(void (*u)(T&, L&, E&, size_t, size_t, polyprediction*, bool)) { learn_fd.multipredict_f = (learn_data::multi_fn)u; }
+  template<class L>
+  inline void set_predict_batch(void (*u)(T&, L&, E**, size_t)) { learn_fd.predict_batch_f = (learn_data::batch_fn)u; }
 
   inline void update(E& ec, size_t i=0)
   { assert((is_multiline && std::is_same<multi_ex, E>::value) ||
@@ -291,6 +320,7 @@ public:
       ret.learn_fd.update_f = (learn_data::fn)learn;
       ret.learn_fd.predict_f = (learn_data::fn)predict;
       ret.learn_fd.multipredict_f = nullptr;
+      ret.learn_fd.predict_batch_f = nullptr;
       ret.pred_type = pred_type;
       ret.is_multiline = std::is_same<multi_ex, E>::value;
 
@@ -0,0 +1,159 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "lz_codec.h"
+
+namespace
+{
+const size_t min_match = 4;
+const size_t last_literals = 5;  // the format ends every block with at least this many literals
+const size_t match_margin = 12;  // and never starts a match this close to the end
+const size_t max_offset = 65535;
+const int hash_bits = 12;
+
+inline uint32_t load32(const uint8_t* p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t hash4(uint32_t v) { return (v * 2654435761U) >> (32 - hash_bits); }
+
+uint8_t* write_length(uint8_t* op, size_t len)
+{
+  for (; len >= 255; len -= 255)
+    *op++ = 255;
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+uint8_t* write_literals(uint8_t* op, uint8_t* token, const uint8_t* literals, size_t len)
+{
+  *token = (uint8_t)((len < 15 ? len : 15) << 4);
+  if (len >= 15)
+    op = write_length(op, len - 15);
+  memcpy(op, literals, len);
+  return op + len;
+}
+
+bool read_length(const uint8_t*& ip, const uint8_t* iend, size_t& len)
+{
+  uint8_t b;
+  do
+  {
+    if (ip == iend)
+      return false;
+    b = *ip++;
+    len += b;
+  }
+  while (b == 255);
+  return true;
+}
+}
+
+namespace LZ
+{
+size_t compress_bound(size_t n) { return n + n / 255 + 16; }
+
+size_t compress(const char* src, size_t n, char* dst)
+{
+  const uint8_t* in = (const uint8_t*)src;
+  uint8_t* op = (uint8_t*)dst;
+  size_t anchor = 0;
+
+  if (n > match_margin)
+  {
+    uint32_t table[1 << hash_bits];
+    memset(table, 0, sizeof(table));
+    size_t match_limit = n - match_margin;
+    size_t end_limit = n - last_literals;
+    size_t misses = 0;
+
+    for (size_t i = 1; i < match_limit;)
+    {
+      uint32_t seq = load32(in + i);
+      uint32_t& slot = table[hash4(seq)];
+      size_t ref = slot;
+      slot = (uint32_t)i;
+      if (i - ref > max_offset || load32(in + ref) != seq)
+      { // skip faster through data that doesn't compress
+        i += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+
+      size_t len = min_match;
+      while (i + len < end_limit && in[ref + len] == in[i + len])
+        len++;
+
+      uint8_t* token = op++;
+      op = write_literals(op, token, in + anchor, i - anchor);
+      size_t offset = i - ref;
+      *op++ = (uint8_t)offset;
+      *op++ = (uint8_t)(offset >> 8);
+      size_t extra = len - min_match;
+      *token |= (uint8_t)(extra < 15 ? extra : 15);
+      if (extra >= 15)
+        op = write_length(op, extra - 15);
+
+      i += len;
+      anchor = i;
+    }
+  }
+
+  uint8_t* token = op++;
+  op = write_literals(op, token, in + anchor, n - anchor);
+  return op - (uint8_t*)dst;
+}
+
+bool decompress(const char* src, size_t n, char* dst, size_t raw)
+{
+  const uint8_t* ip = (const uint8_t*)src;
+  const uint8_t* iend = ip + n;
+  uint8_t* out = (uint8_t*)dst;
+  uint8_t* op = out;
+  uint8_t* oend = out + raw;
+
+  while (ip < iend)
+  {
+    uint8_t token = *ip++;
+    size_t literals = token >> 4;
+    if (literals == 15 && !read_length(ip, iend, literals))
+      return false;
+    if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op))
+      return false;
+    memcpy(op, ip, literals);
+    op += literals;
+    ip += literals;
+    if (ip == iend)
+      break;
+
+    if (iend - ip < 2)
+      return false;
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - out))
+      return false;
+    size_t len = token & 15;
+    if (len == 15 && !read_length(ip, iend, len))
+      return false;
+    len += min_match;
+    if (len > (size_t)(oend - op))
+      return false;
+
+    const uint8_t* match = op - offset;
+    if (offset >= len)
+      memcpy(op, match, len);
+    else // the match overlaps what it produces, a run
+      for (size_t i = 0; i < len; i++)
+        op[i] = match[i];
+    op += len;
+  }
+  return op == oend;
+}
+}
@@ -0,0 +1,24 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#pragma once
+#include <stddef.h>
+
+/* A byte-oriented LZ77 codec in the LZ4 block format, tuned for decompression
+   speed rather than ratio.  Each sequence is a token (literal length, match
+   length - 4), the literals, a 16 bit little endian match offset and any
+   length bytes that didn't fit in the token; the last sequence holds only
+   literals. */
+namespace LZ
+{
+//the largest compressed size of n bytes
+size_t compress_bound(size_t n);
+
+//compresses n bytes of src into dst, which must hold compress_bound(n) bytes; returns the compressed size
+size_t compress(const char* src, size_t n, char* dst);
+
+//decompresses n bytes of src into exactly raw bytes of dst; false if src is corrupt
+bool decompress(const char* src, size_t n, char* dst, size_t raw);
+}
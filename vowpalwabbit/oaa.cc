@@ -10,6 +10,7 @@ license as described in the file LICENSE.
 #include "rand48.h"
 #include "vw_exception.h"
 #include "vw.h"
+#include "gd.h"
 
 using namespace std;
 struct oaa
@@ -125,6 +126,17 @@ void predict_or_learn(oaa& o, LEARNER::single_learner& base, example& ec)
   ec.l.multi = mc_label_data;
 }
 
+template <bool print_all, bool scores, bool probabilities>
+void predict_batch(oaa& o, LEARNER::single_learner& base, example** ecs, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (i + 1 < count)
+      GD::prefetch_weights(*o.all, *ecs[i + 1]);
+    predict_or_learn<false, print_all, scores, probabilities>(o, base, *ecs[i]);
+  }
+}
+
 void finish(oaa&o)
 {
   free(o.pred);
@@ -255,6 +267,7 @@ LEARNER::base_learner* oaa_setup(arguments& arg)
       // the three boolean template parameters are: is_learn, print_all and scores
       l = &LEARNER::init_multiclass_learner(data, base, predict_or_learn<true, false, true, true>,
                                             predict_or_learn<false, false, true, true>, arg.all->p, data->k, prediction_type::scalars);
+      l->set_predict_batch(predict_batch<false, true, true>);
       arg.all->sd->report_multiclass_log_loss = true;
       l->set_finish_example(finish_example_scores<true>);
     }
@@ -262,18 +275,27 @@ LEARNER::base_learner* oaa_setup(arguments& arg)
     {
       l = &LEARNER::init_multiclass_learner(data, base, predict_or_learn<true, false, true, false>,
                                             predict_or_learn<false, false, true, false>, arg.all->p, data->k, prediction_type::scalars);
+      l->set_predict_batch(predict_batch<false, true, false>);
       l->set_finish_example(finish_example_scores<false>);
     }
   }
   else if (arg.all->raw_prediction > 0)
+  {
     l = &LEARNER::init_multiclass_learner(data, base, predict_or_learn<true, true, false, false>,
                                           predict_or_learn<false, true, false, false>, arg.all->p, data->k, prediction_type::multiclass);
+    l->set_predict_batch(predict_batch<true, false, false>);
+  }
   else
+  {
     l = &LEARNER::init_multiclass_learner(data, base,predict_or_learn<true, false, false, false>,
                                           predict_or_learn<false, false, false, false>, arg.all->p, data->k, prediction_type::multiclass);
+    l->set_predict_batch(predict_batch<false, false, false>);
+  }
 
   if (data_ptr->num_subsample > 0)
+  {
     l->set_learn(learn_randomized);
+  }
   l->set_finish(finish);
 
   return make_base(*l);
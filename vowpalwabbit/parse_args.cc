@@ -14,6 +14,11 @@ license as described in the file LICENSE.
 
 #include "parse_regressor.h"
 #include "parser.h"
+#include "cache.h"
+#include "hash_cache.h"
+#include "hot_swap.h"
+#include "delta_checkpoint.h"
+#include "background_checkpoint.h"
 #include "parse_primitives.h"
 #include "vw.h"
 #include "interactions.h"
@@ -387,13 +392,20 @@ void parse_source(arguments& arg)
     ("port", po::value<size_t>(),"port to listen on; use 0 to pick unused port")
     ("num_children", arg.all->num_children, "number of children for persistent daemon mode")
     ("pid_file", po::value< string >(), "Write pid file in persistent daemon mode")
+    ("hot_swap", "in persistent daemon mode, reload the -i model on SIGHUP without interrupting the children")
     ("port_file", po::value< string >(), "Write port used in persistent daemon mode")
     ("cache,c", "Use a cache.  The default is <data>.cache")
     ("cache_file", po::value< vector<string> >(), "The location(s) of cache_file.")
     ("json", "Enable JSON parsing.")
     ("dsjson", "Enable Decision Service JSON parsing.")
     ("kill_cache,k", "do not reuse existing cache: create a new one always")
+    (arg.all->p->blocks->write_blocks, "block_cache", "write the cache in independently decodable blocks with an index")
+    ("cache_block_size", arg.all->p->blocks->block_size, "approximate size of a block of a --block_cache in bytes")
+    (arg.all->p->blocks->shuffle, "shuffle_blocks", "read the blocks of a block cache in a different random order on every pass")
+    (arg.all->p->blocks->compress, "compress_blocks", "write a --block_cache with blocks compressed by a fast LZ codec")
     ("compressed", "use gzip format whenever possible. If a cache file is being created, this option creates a compressed cache file. A mixture of raw-text & compressed inputs are supported with autodetection.")
+    ("inflate_ahead", po::value<size_t>(), "1 to inflate gzip input and caches on a thread of their own ahead of the parser, 0 to inflate them as they are read (default: 1 with more than one core)")
+    ("mmap", "read regular input and cache files through a memory mapping instead of copying them")
     (arg.all->stdin_off, "no_stdin", "do not default to reading from stdin").missing();
 
   // Be friendly: if -d was left out, treat positional param as data file
@@ -424,6 +436,33 @@ void parse_source(arguments& arg)
   if (ends_with(arg.all->data_filename, ".gz"))
     set_compressed(arg.all->p);
 
+  if (arg.vm.count("inflate_ahead") && arg.all->p->input->compressed())
+    ((comp_io_buf*)arg.all->p->input)->read_ahead = arg.vm["inflate_ahead"].as<size_t>() > 0;
+
+  if (arg.all->p->blocks->compress)
+    arg.all->p->blocks->write_blocks = true;
+  if (arg.all->p->blocks->write_blocks && arg.all->p->output->compressed())
+    THROW("--block_cache can't be combined with --compressed");
+
+  if (arg.all->p->blocks->shuffle)
+  {
+    arg.all->p->blocks->random_state = arg.all->random_seed;
+    if (!arg.all->holdout_set_off)
+    {
+      arg.all->holdout_set_off = true;
+      arg.trace_message << "Making holdout_set_off=true since blocks are shuffled" << endl;
+    }
+  }
+
+  if (arg.vm.count("mmap") && (arg.vm.count("json") || arg.vm.count("dsjson")))
+    THROW("--mmap maps the input read only, and the JSON parser writes into it, so it can't be combined with --json or --dsjson");
+  if (arg.vm.count("mmap") && !arg.all->p->input->compressed() && !arg.all->daemon)
+    set_mapped(arg.all->p);
+
+  if (arg.all->checkpoint != nullptr && (arg.all->daemon || arg.all->learn_threads > 1))
+    THROW("--background_checkpoints snapshots the model by forking, which takes no snapshot of the weights --daemon shares with its "
+          "children, nor of the learners of --threads, so it can't be combined with them");
+
   if ((arg.vm.count("cache") || arg.vm.count("cache_file")) && arg.vm.count("invert_hash"))
     THROW("invert_hash is incompatible with a cache file.  Use it in single pass mode only.");
 
@@ -1033,8 +1072,14 @@ void parse_output_model(arguments& arg)
       ("readable_model", arg.all->text_regressor_name, "Output human-readable final regressor with numeric features")
       ("invert_hash", arg.all->inv_hash_regressor_name, "Output human-readable final regressor with feature names.  Computationally expensive.")
       (arg.all->save_resume, "save_resume", "save extra state so learning can be resumed later with new data")
+      (arg.all->aligned_model, "aligned_model", "save dense weights as one page-aligned block, which vw -t maps instead of reading")
+      ("model_threads", arg.all->model_threads, "threads encoding and decoding the weights of binary models, default one per core")
+      ("export_serving_model", arg.all->serving_model_name, "Also save the final weights alone, quantized for vw -t, to <arg>")
+      ("serving_precision", po::value< string >(), "int8 (default) or fp16 weights in --export_serving_model")
       (arg.all->preserve_performance_counters, "preserve_performance_counters", "reset performance counters when warmstarting")
       (arg.all->save_per_pass, "save_per_pass", "Save the model after every pass over data")
+      ("delta_checkpoints", "Save models after the first per pass or save command as deltas of the pages of weights that changed, load with -i <first> -i <delta> ...")
+      ("background_checkpoints", "Write models saved per pass or by a save command from a forked snapshot while learning goes on")
       ("output_feature_regularizer_binary", arg.all->per_feature_regularizer_output, "Per feature regularization output file")
       ("output_feature_regularizer_text", arg.all->per_feature_regularizer_text, "Per feature regularization output file, in text")
       ("id", arg.all->id, "User supplied ID embedded into the final regressor").missing())
@@ -1046,6 +1091,37 @@ void parse_output_model(arguments& arg)
   if (arg.vm.count("invert_hash"))
     arg.all->hash_inv = true;
 
+  if (arg.all->aligned_model && arg.all->weights.sparse)
+    THROW("--aligned_model saves dense weights, it can't be combined with --sparse_weights");
+
+  if (arg.vm.count("serving_precision"))
+  {
+    string precision = arg.vm["serving_precision"].as<string>();
+    if (precision == "int8")
+      arg.all->serving_bits = 8;
+    else if (precision == "fp16")
+      arg.all->serving_bits = 16;
+    else
+      THROW("--serving_precision must be int8 or fp16, not " << precision);
+  }
+
+  if (arg.all->serving_model_name.length() > 0 && arg.all->weights.sparse)
+    THROW("--export_serving_model saves dense weights, it can't be combined with --sparse_weights");
+
+  if (arg.vm.count("delta_checkpoints"))
+  {
+    if (arg.all->weights.sparse || arg.all->save_resume)
+      THROW("--delta_checkpoints saves the dense predictor weights, it can't be combined with --sparse_weights or --save_resume");
+    arg.all->deltas = new delta_checkpoint();
+  }
+
+  if (arg.vm.count("background_checkpoints"))
+  {
+    if (arg.all->deltas != nullptr)
+      THROW("--background_checkpoints can't be combined with --delta_checkpoints");
+    arg.all->checkpoint = new background_checkpoint();
+  }
+
   if (arg.vm.count("id") && find(arg.args.begin(), arg.args.end(), "--id") == arg.args.end())
   {
     arg.args.push_back("--id");
@@ -1075,6 +1151,8 @@ void load_input_model(vw& all, io_buf& io_temp)
     all.l->save_load(io_temp, true, false);
     io_temp.close_file();
   }
+
+  apply_model_deltas(all);
 }
 
 LEARNER::base_learner* setup_base(arguments& args)
@@ -1195,7 +1273,14 @@ vw& parse_args(int argc, char *argv[], trace_message_t trace_listener, void* tra
 
     all.opts_n_args.new_options("VW options")
       ("ring_size", all.p->ring_size, "size of example ring")
-      ("onethread", "Disable parse thread").missing();
+      (all.p->lockfree_ring, "lockfree_ring", "pass examples between the parse thread and the learner without locking the example ring")
+      ("onethread", "Disable parse thread")
+      ("parse_threads", all.p->parse_threads, "number of threads parsing text input in parallel")
+      (all.p->parse_unordered, "unordered_parse", "with --parse_threads, pass examples to the learner as soon as they are parsed rather than in input order")
+      ("hash_cache", all.p->hash_cache_size, "remember the hashes of up to <arg> recent feature names in each parse thread").missing();
+
+    if (all.p->hash_cache_size > 0)
+      all.p->hashes = new hash_cache(all.p->hash_cache_size);
 
     all.opts_n_args.new_options("Update options")
       ("learning_rate,l", all.eta, "Set learning rate")
@@ -1212,11 +1297,17 @@ vw& parse_args(int argc, char *argv[], trace_message_t trace_listener, void* tra
       ("normal_weights", all.normal_weights, "make initial weights normal")
       ("truncated_normal_weights", all.tnormal_weights, "make initial weights truncated normal")
       (all.weights.sparse, "sparse_weights", "Use a sparse datastructure for weights")
+      (all.weights.pages.huge, "huge_pages", "Back the weights with huge pages")
+      (all.weights.pages.interleave, "numa_interleave", "Interleave the weights over the NUMA nodes")
+      ("prefetch_distance", all.weights.prefetch_distance, "Prefetch the weights of features <arg> ahead in the feature loops, 0 to not prefetch.  Default 16 when the weights exceed 32MB")
       ("input_feature_regularizer", all.per_feature_regularizer_input, "Per feature regularization input file").missing();
 
+    if (all.weights.sparse && all.weights.pages.mapped())
+      THROW("--huge_pages and --numa_interleave apply to dense weights, not --sparse_weights");
+
     all.opts_n_args.new_options("Parallelization options")
       ("span_server", po::value<string>(), "Location of server for setting up spanning tree")
-      ("threads", "Enable multi-threading")
+      ("threads", po::value(&all.learn_threads)->implicit_value(1), "learn with <arg> threads updating shared weights without locks (gd only)")
       ("unique_id", po::value<size_t>()->default_value(0), "unique id used for cluster parallel jobs")
       ("total", po::value<size_t>()->default_value(1), "total number of nodes used in cluster parallel job")
       ("node", po::value<size_t>()->default_value(0), "node number in cluster parallel job").missing();
@@ -1331,6 +1422,24 @@ void parse_sources(vw& all, io_buf& model, bool skipModelLoad)
     i++;
   all.wpp = (1 << i) >> all.weights.stride_shift();
 
+  if (all.learn_threads > 1)
+  { // hogwild updates are only safe in the scorer over gd, whose state is the weights and running sums
+    if (all.scorer == nullptr || all.l != LEARNER::make_base(*all.scorer)
+        || all.scorer->get_learn_base()->get_learn_base() != nullptr || all.reduction_stack.size() != 0)
+      THROW("--threads supports gd regression without reductions");
+    if (all.weights.sparse || all.audit || all.hash_inv || all.daemon || all.p->lockfree_ring || all.opts_n_args.vm.count("onethread")
+        || all.opts_n_args.vm.count("interaction_cache"))
+      THROW("--threads can't be combined with --sparse_weights, --audit, --invert_hash, --daemon, --lockfree_ring, --onethread or --interaction_cache");
+  }
+
+  if (all.weights.serving_bits != 0 || all.serving_model_name.length() > 0)
+  { // only gd's predictions, and the reductions that predict through them, read the quantized serving weights
+    po::variables_map& vm = all.opts_n_args.vm;
+    for (const char* reads_weights : { "lrq", "lrqfa", "ftrl", "pistol", "svrg", "OjaNewton", "rank", "ksvm", "lda", "audit_regressor" })
+      if (vm.count(reads_weights) && (vm[reads_weights].value().type() != typeid(bool) || vm[reads_weights].as<bool>()))
+        THROW("--" << reads_weights << " reads the float weights itself, so a serving model (--export_serving_model) can't be saved or loaded with it");
+  }
+
   if (all.opts_n_args.vm.count("help"))
   {
     /* upon direct query for help -- spit it out to stdout */
@@ -1553,6 +1662,13 @@ void finish(vw& all, bool delete_all)
     all.opts_n_args.trace_message << endl << "total feature number = " << all.sd->total_features;
     if (all.sd->queries > 0)
       all.opts_n_args.trace_message << endl << "total queries = " << all.sd->queries;
+    if (all.p->hashes != nullptr && all.p->hashes->lookups > 0)
+      all.opts_n_args.trace_message << endl << "hash cache hits = " << all.p->hashes->hits << " of " << all.p->hashes->lookups
+                                    << " (" << 100. * all.p->hashes->hits / all.p->hashes->lookups << "%)";
+    if (!all.weights.sparse && all.weights.pages.mapped())
+      all.opts_n_args.trace_message << endl << "weight pages = " << all.weights.dense_weights.pages_description();
+    if (all.checkpoint != nullptr && all.checkpoint->saves > 0)
+      all.opts_n_args.trace_message << endl << "learning paused for checkpoints = " << all.checkpoint->paused << " sec in " << all.checkpoint->saves << " saves";
     all.opts_n_args.trace_message << endl;
   }
 
@@ -1620,6 +1736,14 @@ void finish(vw& all, bool delete_all)
 
   delete all.all_reduce;
 
+  delete all.swap;
+
+  delete all.deltas;
+
+  if (all.checkpoint != nullptr)
+    wait_for_checkpoint(all);
+  delete all.checkpoint;
+
   if (delete_all) delete &all;
 
   if (finalize_regressor_exception_thrown)
@@ -1,4 +1,6 @@
 #pragma once
+#include "parse_pool.h"
+#include "cache.h"
 
 using dispatch_fptr = std::function<void(vw&, v_array<example*>&)>;
 
@@ -11,8 +13,23 @@ inline void parse_dispatch(vw& all, dispatch_fptr dispatch)
   {
     while(!all.p->done)
     {
+      bool cached = all.p->reader == read_cached_blocks;
+      bool pooled = all.p->pool != nullptr && (all.p->reader == read_features_string || cached);
+      if (pooled)
+      { // text lines and block cache records are parsed and published by the worker pool
+        if (!all.do_reset_source && example_number != all.pass_length && all.max_examples > example_number)
+        {
+          size_t max_examples = std::min(all.pass_length - example_number, all.max_examples - example_number);
+          size_t queued = cached ? queue_cache_records(all, max_examples) : queue_text_lines(all, max_examples);
+          example_number += queued;
+          if (queued > 0)
+            continue;
+        }
+        drain_parse_pool(all);
+      }
+
       examples.push_back(&VW::get_unused_example(&all)); // need at least 1 example
-      if (!all.do_reset_source && example_number != all.pass_length && all.max_examples > example_number && all.p->reader(&all, examples) > 0)
+      if (!pooled && !all.do_reset_source && example_number != all.pass_length && all.max_examples > example_number && all.p->reader(&all, examples) > 0)
       {
         VW::setup_examples(all, examples);
         example_number+=examples.size();
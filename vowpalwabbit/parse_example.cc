@@ -7,6 +7,8 @@ license as described in the file LICENSE.
 #include <math.h>
 #include <ctype.h>
 #include "parse_example.h"
+#include "delimiter_scan.h"
+#include "hash_cache.h"
 #include "hash.h"
 #include "unique_sort.h"
 #include "global_data.h"
@@ -70,10 +72,15 @@ public:
   bool* spelling_features;
   v_array<char> spelling;
   uint32_t hash_seed;
+  hash_cache* hashes;
 
   vector<feature_dict*>* namespace_dictionaries;
 
-  ~TC_parser() { }
+  uint64_t* delimiters; // find_delimiters of the line
+  uint64_t short_line_delimiters[32];
+  v_array<uint64_t> long_line_delimiters;
+
+  ~TC_parser() { long_line_delimiters.delete_v(); }
 
   inline void parserWarning(const char* message, char* begin, char* pos, const char* message2)
   {
@@ -116,8 +123,11 @@ public:
   {
     substring ret;
     ret.begin = reading_head;
-    while( !(*reading_head == ' ' || *reading_head == ':' || *reading_head == '\t' || *reading_head == '|' || reading_head == endLine || *reading_head == '\r' ))
-      ++reading_head;
+    if (reading_head < endLine)
+      reading_head = beginLine + next_delimiter(delimiters, reading_head - beginLine, endLine - beginLine);
+    else // a namespace value parsed past the end of the line
+      while( !(*reading_head == ' ' || *reading_head == ':' || *reading_head == '\t' || *reading_head == '|' || reading_head == endLine || *reading_head == '\r' ))
+        ++reading_head;
     ret.end = reading_head;
 
     return ret;
@@ -135,10 +145,12 @@ public:
       substring feature_name=read_name();
       v = cur_channel_v * featureValue();
       uint64_t word_hash;
-      if (feature_name.end != feature_name.begin)
-        word_hash = (p->hasher(feature_name, channel_hash));
-      else
+      if (feature_name.end == feature_name.begin)
         word_hash = channel_hash + anon++;
+      else if (hashes != nullptr)
+        word_hash = hashes->hash(p->hasher, feature_name, channel_hash);
+      else
+        word_hash = (p->hasher(feature_name, channel_hash));
       if(v == 0) return; //dont add 0 valued features to list of features
       features& fs = ae->feature_space[index];
       fs.push_back(v, word_hash);
@@ -371,11 +383,22 @@ public:
     }
   }
 
-  TC_parser(char* reading_head, char* endLine, vw& all, example* ae)
+  TC_parser(char* reading_head, char* endLine, vw& all, example* ae, hash_cache* hashes)
   {
     spelling = v_init<char>();
+    long_line_delimiters = v_init<uint64_t>();
     if (endLine != reading_head)
     {
+      size_t words = delimiter_words(endLine - reading_head);
+      if (words <= sizeof(short_line_delimiters) / sizeof(uint64_t))
+        delimiters = short_line_delimiters;
+      else
+      {
+        long_line_delimiters.resize(words);
+        delimiters = long_line_delimiters.begin();
+      }
+      find_delimiters(reading_head, endLine - reading_head, delimiters);
+
       this->beginLine = reading_head;
       this->reading_head = reading_head;
       this->endLine = endLine;
@@ -388,6 +411,7 @@ public:
       this->namespace_dictionaries = all.namespace_dictionaries;
       this->base = nullptr;
       this->hash_seed = all.hash_seed;
+      this->hashes = hashes;
       listNameSpace();
       if (base != nullptr)
         free(base);
@@ -395,9 +419,9 @@ public:
   }
 };
 
-void substring_to_example(vw* all, example* ae, substring example)
+void substring_to_example_label(vw* all, parser* p, example* ae, substring example)
 {
-  all->p->lp.default_label(&ae->l);
+  p->lp.default_label(&ae->l);
   char* bar_location = safe_index(example.begin, '|', example.end);
   char* tab_location = safe_index(example.begin, '\t', bar_location);
   substring label_space;
@@ -413,29 +437,39 @@ void substring_to_example(vw* all, example* ae, substring example)
 
   if (*example.begin == '|')
   {
-    all->p->words.clear();
+    p->words.clear();
   }
   else
   {
-    tokenize(' ', label_space, all->p->words);
-    if (all->p->words.size() > 0 && (all->p->words.last().end == label_space.end	|| *(all->p->words.last().begin) == '\'')) //The last field is a tag, so record and strip it off
+    tokenize(' ', label_space, p->words);
+    if (p->words.size() > 0 && (p->words.last().end == label_space.end	|| *(p->words.last().begin) == '\'')) //The last field is a tag, so record and strip it off
     {
-      substring tag = all->p->words.pop();
+      substring tag = p->words.pop();
       if (*tag.begin == '\'')
         tag.begin++;
       push_many(ae->tag, tag.begin, tag.end - tag.begin);
     }
   }
 
-  if (all->p->words.size() > 0)
-    all->p->lp.parse_label(all->p, all->sd, &ae->l, all->p->words);
+  if (p->words.size() > 0)
+    p->lp.parse_label(p, all->sd, &ae->l, p->words);
+}
+
+void substring_to_example_features(vw* all, example* ae, substring example, hash_cache* hashes)
+{
+  char* bar_location = safe_index(example.begin, '|', example.end);
 
   if (all->audit || all->hash_inv)
-    TC_parser<true> parser_line(bar_location,example.end,*all,ae);
+    TC_parser<true> parser_line(bar_location,example.end,*all,ae,hashes);
   else
-    TC_parser<false> parser_line(bar_location,example.end,*all,ae);
+    TC_parser<false> parser_line(bar_location,example.end,*all,ae,hashes);
 }
 
+void substring_to_example(vw* all, example* ae, substring example)
+{
+  substring_to_example_label(all, all->p, ae, example);
+  substring_to_example_features(all, ae, example, all->p->hashes);
+}
 
 namespace VW
 {
@@ -9,6 +9,8 @@ license as described in the file LICENSE.
 #include "example.h"
 #include "vw.h"
 
+struct hash_cache;
+
 //example processing
 typedef enum
 { StringFeatures,
@@ -16,6 +18,10 @@ typedef enum
 } FeatureInputType;
 
 void substring_to_example(vw* all, example* ae, substring example);
+// the two halves of substring_to_example.  The feature half only touches the example, so it may run on
+// a parse worker; the label half uses the word buffers of p and updates label statistics in all->sd.
+void substring_to_example_label(vw* all, parser* p, example* ae, substring example);
+void substring_to_example_features(vw* all, example* ae, substring example, hash_cache* hashes);
 
 namespace VW
 {
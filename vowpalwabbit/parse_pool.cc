@@ -0,0 +1,408 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD (revised)
+license as described in the file LICENSE.
+ */
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <exception>
+
+#include "parse_pool.h"
+#include "parse_example.h"
+#include "cache.h"
+#include "hash_cache.h"
+#include "unique_sort.h"
+#include "vw.h"
+
+using namespace std;
+
+struct text_job
+{
+  v_array<char> text;         // the lines (or cache records) of the job, each followed by a '\n'
+  v_array<size_t> ends;       // offset of the end of each line in text
+  v_array<example*> examples; // ring slots claimed for the lines, in input order
+  v_array<bool> no_features;  // example had no namespaces before setup, see example_is_newline
+  bool cached;                // the lines are records of a block cache rather than text
+  uint64_t ticket;
+
+  substring line(size_t i)
+  {
+    size_t begin = i == 0 ? 0 : ends[i-1] + 1;
+    substring ret = { text.begin() + begin, text.begin() + ends[i] };
+    return ret;
+  }
+
+  void clear()
+  {
+    text.clear();
+    ends.clear();
+    examples.clear();
+    no_features.clear();
+  }
+
+  void delete_v()
+  {
+    text.delete_v();
+    ends.delete_v();
+    examples.delete_v();
+    no_features.delete_v();
+  }
+};
+
+struct parse_pool
+{
+  vw* all;
+  size_t batch; // lines per job
+  bool unordered;
+
+  vector<thread> threads;
+  vector<text_job*> jobs;
+
+  mutex queue_lock;
+  condition_variable job_queued;
+  condition_variable job_recycled;
+  deque<text_job*> queued;
+  vector<text_job*> free_jobs;
+  size_t outstanding; // jobs handed to the workers and not yet recycled
+  uint64_t next_ticket;
+  bool stop;
+
+  mutex publish_lock;
+  vector<text_job*> parsed; // parsed jobs waiting for their turn, indexed by ticket
+  uint64_t next_publish;
+  memory_io_buf label_view; // labels of cache records are decoded again with all.sd while publishing
+  exception_ptr error;
+};
+
+namespace
+{
+text_job* take_queued(parse_pool& pool)
+{
+  unique_lock<mutex> lock(pool.queue_lock);
+  pool.job_queued.wait(lock, [&pool] { return pool.stop || !pool.queued.empty(); });
+  if (pool.queued.empty())
+    return nullptr;
+  text_job* job = pool.queued.front();
+  pool.queued.pop_front();
+  return job;
+}
+
+void recycle(parse_pool& pool, text_job* job)
+{
+  unique_lock<mutex> lock(pool.queue_lock);
+  pool.free_jobs.push_back(job);
+  pool.outstanding--;
+  pool.job_recycled.notify_all();
+}
+
+struct worker_state
+{
+  v_array<size_t> gram_mask;
+  hash_cache* hashes;
+  memory_io_buf record_view;
+  shared_data scratch_sd; // read_cached_label may count labels; that happens for real when publishing
+};
+
+void parse_job(parse_pool& pool, text_job& job, worker_state& state)
+{
+  vw& all = *pool.all;
+  for (size_t i = 0; i < job.examples.size(); i++)
+  {
+    example* ae = job.examples[i];
+    substring line = job.line(i);
+    if (job.cached)
+    {
+      state.record_view.view(line.begin, line.end);
+      if (read_cached_example(&all, &state.scratch_sd, state.record_view, ae) == 0)
+        THROW("truncated example in block cache");
+    }
+    else
+      substring_to_example_features(&all, ae, line, state.hashes);
+
+    if (all.p->sort_features && ae->sorted == false)
+      unique_sort_features(all.parse_mask, ae);
+
+    job.no_features.push_back(ae->indices.size() == 0 ||
+                              (ae->indices.size() == 1 && ae->indices.last() == constant_namespace));
+
+    // the cache holds features as parsed, so expansion must wait until the example is cached
+    if (!all.p->write_cache)
+      setup_example_features(all, ae, state.gram_mask);
+  }
+}
+
+// runs with publish_lock held: everything here depends on the order examples reach the learner
+void publish_job(parse_pool& pool, text_job& job)
+{
+  vw& all = *pool.all;
+  for (size_t i = 0; i < job.examples.size(); i++)
+  {
+    example* ae = job.examples[i];
+    substring line = job.line(i);
+    if (job.cached)
+    {
+      pool.label_view.view(line.begin, line.end);
+      all.p->lp.read_cached_label(all.sd, &ae->l, pool.label_view);
+    }
+    else
+      substring_to_example_label(&all, all.p, ae, line);
+
+    if (all.p->write_cache)
+      cache_example(all, ae);
+
+    setup_example_counters(all, ae, ae->tag.size() == 0 && job.no_features[i]);
+
+    if (all.p->write_cache)
+      setup_example_features(all, ae, all.p->gram_mask);
+
+    publish_examples(all, &ae, 1);
+  }
+}
+
+void finish_job(parse_pool& pool, text_job* job)
+{
+  vector<text_job*> done;
+  {
+    lock_guard<mutex> lock(pool.publish_lock);
+    if (pool.unordered)
+    {
+      if (!pool.error)
+        try { publish_job(pool, *job); }
+        catch (...) { pool.error = current_exception(); }
+      done.push_back(job);
+    }
+    else
+    {
+      pool.parsed[job->ticket % pool.parsed.size()] = job;
+      text_job* next;
+      while ((next = pool.parsed[pool.next_publish % pool.parsed.size()]) != nullptr)
+      {
+        pool.parsed[pool.next_publish++ % pool.parsed.size()] = nullptr;
+        if (!pool.error)
+          try { publish_job(pool, *next); }
+          catch (...) { pool.error = current_exception(); }
+        done.push_back(next);
+      }
+    }
+  }
+  for (text_job* j : done)
+    recycle(pool, j);
+}
+
+void parse_worker(parse_pool* pool)
+{
+  worker_state state;
+  state.gram_mask = v_init<size_t>();
+  state.hashes = pool->all->p->hash_cache_size > 0 ? new hash_cache(pool->all->p->hash_cache_size) : nullptr;
+  state.scratch_sd = shared_data();
+  state.scratch_sd.is_more_than_two_labels_observed = true;
+  text_job* job;
+  while ((job = take_queued(*pool)) != nullptr)
+  {
+    try { parse_job(*pool, *job, state); }
+    catch (...)
+    {
+      lock_guard<mutex> lock(pool->publish_lock);
+      if (!pool->error)
+        pool->error = current_exception();
+    }
+    finish_job(*pool, job);
+  }
+  state.gram_mask.delete_v();
+
+  if (state.hashes != nullptr)
+  {
+    lock_guard<mutex> lock(pool->publish_lock);
+    pool->all->p->hashes->lookups += state.hashes->lookups;
+    pool->all->p->hashes->hits += state.hashes->hits;
+    delete state.hashes;
+  }
+}
+
+void rethrow_worker_error(parse_pool& pool)
+{
+  exception_ptr error;
+  {
+    lock_guard<mutex> lock(pool.publish_lock);
+    error = pool.error;
+  }
+  if (error)
+    rethrow_exception(error);
+}
+}
+
+void start_parse_pool(vw& all)
+{
+  parser& p = *all.p;
+  if (p.parse_threads == 0)
+    return;
+
+  const char* reason = nullptr;
+  if (all.daemon || all.active)
+    reason = "daemon and active modes";
+  else if (all.loaded_dictionaries.size() > 0)
+    reason = "--dictionary";
+  else if (p.reader != read_features_string && p.reader != read_cached_blocks)
+    reason = "non-text input other than a --block_cache";
+  if (reason != nullptr)
+  {
+    if (!all.quiet)
+      all.opts_n_args.trace_message << "--parse_threads is not supported with " << reason << ", using a single parse thread" << endl;
+    return;
+  }
+
+  parse_pool* pool = new parse_pool();
+  pool->all = &all;
+  pool->unordered = p.parse_unordered;
+  // keep roughly half of the ring in flight so the learner always has examples to finish
+  size_t num_jobs = 2 * p.parse_threads + 2;
+  pool->batch = max((size_t)1, min((size_t)64, p.ring_size / (2 * num_jobs)));
+  pool->outstanding = 0;
+  pool->next_ticket = 0;
+  pool->next_publish = 0;
+  pool->stop = false;
+  pool->parsed.resize(num_jobs, nullptr);
+  for (size_t i = 0; i < num_jobs; i++)
+  {
+    text_job* job = new text_job();
+    job->text = v_init<char>();
+    job->ends = v_init<size_t>();
+    job->examples = v_init<example*>();
+    job->no_features = v_init<bool>();
+    pool->jobs.push_back(job);
+    pool->free_jobs.push_back(job);
+  }
+  for (size_t i = 0; i < p.parse_threads; i++)
+    pool->threads.push_back(thread(parse_worker, pool));
+
+  p.pool = pool;
+}
+
+void end_parse_pool(vw& all)
+{
+  parse_pool* pool = all.p->pool;
+  if (pool == nullptr)
+    return;
+
+  {
+    lock_guard<mutex> lock(pool->queue_lock);
+    pool->stop = true;
+    pool->job_queued.notify_all();
+  }
+  for (thread& t : pool->threads)
+    t.join();
+  for (text_job* job : pool->jobs)
+  {
+    job->delete_v();
+    delete job;
+  }
+  delete pool;
+  all.p->pool = nullptr;
+}
+
+namespace
+{
+text_job* take_free(parse_pool& pool)
+{
+  rethrow_worker_error(pool);
+
+  text_job* job;
+  {
+    unique_lock<mutex> lock(pool.queue_lock);
+    pool.job_recycled.wait(lock, [&pool] { return !pool.free_jobs.empty(); });
+    job = pool.free_jobs.back();
+    pool.free_jobs.pop_back();
+  }
+  job->clear();
+  return job;
+}
+
+size_t queue_job(parse_pool& pool, text_job* job)
+{
+  size_t count = job->examples.size();
+  unique_lock<mutex> lock(pool.queue_lock);
+  if (count == 0)
+    pool.free_jobs.push_back(job);
+  else
+  {
+    job->ticket = pool.next_ticket++;
+    pool.outstanding++;
+    pool.queued.push_back(job);
+    pool.job_queued.notify_one();
+  }
+  return count;
+}
+}
+
+size_t queue_text_lines(vw& all, size_t max_lines)
+{
+  parse_pool& pool = *all.p->pool;
+  text_job* job = take_free(pool);
+  job->cached = false;
+
+  // without an ordering guarantee a multiline example must be published by a single job
+  bool whole_groups = pool.unordered && all.l->is_multiline;
+  size_t limit = min(max_lines, pool.batch);
+  size_t group_limit = min(max_lines, max((size_t)1, all.p->ring_size / 2));
+  bool in_group = false;
+
+  while (job->examples.size() < limit || (whole_groups && in_group && job->examples.size() < group_limit))
+  {
+    // don't sit on claimed slots while the learner waits for a full ring to drain
+    if (job->examples.size() > 0 && !next_example_unused(*all.p))
+      break;
+
+    char* line;
+    size_t num_chars;
+    if (read_features(&all, line, num_chars) < 1)
+      break;
+    push_many(job->text, line, num_chars);
+    job->ends.push_back(job->text.size());
+    job->text.push_back('\n');
+    in_group = num_chars > 0;
+
+    job->examples.push_back(&VW::get_unused_example(&all));
+  }
+
+  return queue_job(pool, job);
+}
+
+size_t queue_cache_records(vw& all, size_t max_records)
+{
+  parse_pool& pool = *all.p->pool;
+  text_job* job = take_free(pool);
+  job->cached = true;
+
+  // records are only a few bytes each, so they are copied into the job like text lines
+  size_t limit = min(max_records, pool.batch);
+  while (job->examples.size() < limit)
+  {
+    if (job->examples.size() > 0 && !next_example_unused(*all.p))
+      break;
+
+    char* begin;
+    char* end;
+    if (!next_cached_record(all, begin, end))
+      break;
+    push_many(job->text, begin, end - begin);
+    job->ends.push_back(job->text.size());
+    job->text.push_back('\n');
+
+    job->examples.push_back(&VW::get_unused_example(&all));
+  }
+
+  return queue_job(pool, job);
+}
+
+void drain_parse_pool(vw& all)
+{
+  parse_pool& pool = *all.p->pool;
+  {
+    unique_lock<mutex> lock(pool.queue_lock);
+    pool.job_recycled.wait(lock, [&pool] { return pool.outstanding == 0; });
+  }
+  rethrow_worker_error(pool);
+}
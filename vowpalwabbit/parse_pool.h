@@ -0,0 +1,28 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#pragma once
+#include <stddef.h>
+
+/* Parallel parsing of text input (--parse_threads).
+
+   The parse thread keeps reading lines from all.p->input, copies them into jobs
+   and claims their slots in the example ring in input order.  Worker threads turn
+   the feature part of each line into an example; the label, cache and holdout
+   bookkeeping then runs serially while the example is published to the learner,
+   either in input order or (--unordered_parse) in the order jobs complete.
+   Records of a block cache are decoded by the workers in the same way. */
+
+struct vw;
+
+void start_parse_pool(vw& all);
+void end_parse_pool(vw& all);
+
+//read up to max_lines lines and hand them to the workers; returns the number queued, 0 at end of input.
+size_t queue_text_lines(vw& all, size_t max_lines);
+//the same for the records of a --block_cache, which the workers decode.
+size_t queue_cache_records(vw& all, size_t max_records);
+//wait until every queued line has been published to the example ring.
+void drain_parse_pool(vw& all);
@@ -24,6 +24,8 @@ using namespace std;
 #include "vw_exception.h"
 #include "vw_validate.h"
 #include "vw_versions.h"
+#include "delta_checkpoint.h"
+#include "background_checkpoint.h"
 
 template <class T> class set_initial_wrapper
 {
@@ -87,6 +89,18 @@ template<class T> double calculate_sd(vw& all,T& weights)
   double sq_sum = inner_product(diff.begin(), diff.end(), diff.begin(), 0.0);
   return sqrt(sq_sum / my_size);
 }
+void allocate_regressor(vw&, sparse_parameters& weights, size_t length, uint32_t stride_shift)
+{ new(&weights) sparse_parameters(length, stride_shift); }
+
+void allocate_regressor(vw& all, dense_parameters& weights, size_t length, uint32_t stride_shift)
+{
+  new(&weights) dense_parameters(length, stride_shift, all.weights.pages);
+  // weights that fit in the last level cache are only slowed down by the extra instructions
+  const size_t prefetch_bytes = 32 << 20;
+  if (all.opts_n_args.vm.count("prefetch_distance") || (length << stride_shift) * sizeof(weight) > prefetch_bytes)
+    weights.prefetch_distance(all.weights.prefetch_distance);
+}
+
 template<class T> void initialize_regressor(vw& all, T& weights)
 {
   // Regressor is already initialized.
@@ -98,7 +112,7 @@ template<class T> void initialize_regressor(vw& all, T& weights)
   {
     uint32_t ss = weights.stride_shift();
     weights.~T();//dealloc so that we can realloc, now with a known size
-    new(&weights) T(length, ss);
+    allocate_regressor(all, weights, length, ss);
   }
   catch (const VW::vw_exception&)
   {
@@ -548,11 +562,18 @@ void save_predictor(vw& all, string reg_name, size_t current_pass)
   filename << reg_name;
   if (all.save_per_pass)
     filename << "." << current_pass;
-  dump_regressor(all, filename.str(), false);
+  if (all.checkpoint != nullptr)
+    save_in_background(all, filename.str());
+  else if (all.deltas != nullptr)
+    save_delta_checkpoint(all, filename.str());
+  else
+    dump_regressor(all, filename.str(), false);
 }
 
 void finalize_regressor(vw& all, string reg_name)
 {
+  if (all.checkpoint != nullptr) // a checkpoint in flight may be to the same file
+    wait_for_checkpoint(all);
   if (!all.early_terminate)
   {
     if (all.per_feature_regularizer_output.length() > 0)
@@ -568,6 +589,12 @@ void finalize_regressor(vw& all, string reg_name)
       dump_regressor(all, all.inv_hash_regressor_name, true);
       all.print_invert = false;
     }
+    if (all.serving_model_name.length() > 0)
+    {
+      all.serving_export = true;
+      dump_regressor(all, all.serving_model_name, false);
+      all.serving_export = false;
+    }
   }
 }
 
@@ -587,9 +614,14 @@ void parse_regressor_args(vw& all, io_buf& io_temp)
     if (!all.quiet)
     {
       //all.trace_message << "initial_regressor = " << regs[0] << endl;
-      if (regs.size() > 1)
+      // later -i files that are deltas from --delta_checkpoints are applied by load_input_model
+      size_t ignored = 0;
+      for (size_t i = 1; i < regs.size(); i++)
+        if (!vm.count("initial_regressor") || i >= vm["initial_regressor"].as< vector<string> >().size() || !is_model_delta(regs[i]))
+          ignored++;
+      if (ignored > 0)
       {
-        all.opts_n_args.trace_message << "warning: ignoring remaining " << (regs.size() - 1) << " initial regressors" << endl;
+        all.opts_n_args.trace_message << "warning: ignoring remaining " << ignored << " initial regressors" << endl;
       }
     }
   }
@@ -16,6 +16,7 @@ void finalize_regressor(vw& all, std::string reg_name);
 void initialize_regressor(vw& all);
 
 void save_predictor(vw& all, std::string reg_name, size_t current_pass);
+void dump_regressor(vw& all, std::string reg_name, bool as_text);
 void save_load_header(vw& all, io_buf& model_file, bool read, bool text);
 
 void parse_mask_regressor_args(vw& all);
@@ -15,6 +15,15 @@ license as described in the file LICENSE.
 #include <signal.h>
 
 #include <fstream>
+#include <atomic>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#define cpu_relax() _mm_pause()
+#else
+#define cpu_relax() std::this_thread::yield()
+#endif
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -47,6 +56,8 @@ namespace po = boost::program_options;
 
 #include "parse_example.h"
 #include "cache.h"
+#include "hash_cache.h"
+#include "hot_swap.h"
 #include "unique_sort.h"
 #include "constant.h"
 #include "vw.h"
@@ -54,6 +65,7 @@ namespace po = boost::program_options;
 #include "vw_exception.h"
 #include "parse_example_json.h"
 #include "parse_dispatch_loop.h"
+#include "dense_kernels.h"
 
 using namespace std;
 
@@ -129,14 +141,65 @@ void condition_variable_signal_all(CV * pcv)
 #endif
 }
 
+/* --lockfree_ring: the parse thread (or whichever parse worker holds the publish
+   turn) is the only producer and the learner the only consumer, so the ring needs
+   no lock.  Each side spins briefly on the atomics and then parks on the usual
+   condition variable; the parked counters let the other side skip examples_lock
+   entirely unless somebody is actually asleep. */
+struct ring_handoff
+{
+  std::atomic<uint64_t> published; // end_parsed_examples as seen by the learner
+  std::atomic<bool>* unused;       // per slot of parser::examples, the negation of in_use
+  std::atomic<bool> done;
+  std::atomic<int> parked_parsers;
+  std::atomic<int> parked_learners;
+  size_t spins; // polls before parking, 0 on a single core where the other side can't run meanwhile
+};
+
+template<class F> void wait_for(parser& p, std::atomic<int>& parked, CV* cv, F ready)
+{
+  for (size_t i = 0; i < p.handoff->spins; i++)
+  {
+    if (ready())
+      return;
+    cpu_relax();
+  }
+
+  mutex_lock(&p.examples_lock);
+  parked.fetch_add(1);
+  // pairs with the fence in wake_parked: either we see the new state or the waker sees us
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  while (!ready())
+    condition_variable_wait(cv, &p.examples_lock);
+  parked.fetch_sub(1);
+  mutex_unlock(&p.examples_lock);
+}
+
+void wake_parked(parser& p, std::atomic<int>& parked, CV* cv)
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (parked.load(std::memory_order_relaxed) > 0)
+  {
+    mutex_lock(&p.examples_lock);
+    condition_variable_signal_all(cv);
+    mutex_unlock(&p.examples_lock);
+  }
+}
+
 //This should not? matter in a library mode.
 bool got_sigterm;
+bool got_sighup;
 
 void handle_sigterm (int)
 {
   got_sigterm = true;
 }
 
+void handle_sighup (int)
+{
+  got_sighup = true;
+}
+
 bool is_test_only(uint32_t counter, uint32_t period, uint32_t after, bool holdout_off, uint32_t target_modulus)  // target should be 0 in the normal case, or period-1 in the case that emptylines separate examples
 {
   if(holdout_off) return false;
@@ -157,6 +220,14 @@ parser* new_parser()
   ret.done = false;
   ret.used_index = 0;
   ret.jsonp = nullptr;
+  ret.parse_threads = 0;
+  ret.parse_unordered = false;
+  ret.pool = nullptr;
+  ret.hash_cache_size = 0;
+  ret.hashes = nullptr;
+  ret.lockfree_ring = false;
+  ret.handoff = nullptr;
+  ret.blocks = new block_cache();
 
   return &ret;
 }
@@ -168,7 +239,14 @@ void set_compressed(parser* par)
   par->output = new comp_io_buf;
 }
 
-uint32_t cache_numbits(io_buf* buf, int filepointer)
+void set_mapped(parser* par)
+{
+  par->input->close_files();
+  delete par->input;
+  par->input = new mmap_io_buf;
+}
+
+uint32_t cache_numbits(io_buf* buf, int filepointer, bool* blocks = nullptr)
 {
   v_array<char> t = v_init<char>();
 
@@ -199,8 +277,10 @@ uint32_t cache_numbits(io_buf* buf, int filepointer)
     if (buf->read_file(filepointer, &temp, 1) < 1)
       THROW("failed to read");
 
-    if (temp != 'c')
+    if (temp != cache_stream && temp != cache_blocks)
       THROW("data file is not a cache file");
+    if (blocks != nullptr)
+      *blocks = temp == cache_blocks;
   }
   catch(...)
   {
@@ -229,9 +309,11 @@ bool member(v_array<int> ids, int id)
 void reset_source(vw& all, size_t numbits)
 {
   io_buf* input = all.p->input;
+  reset_block_cache(all);
   input->current = 0;
   if (all.p->write_cache)
   {
+    finish_block_cache(all);
     all.p->output->flush();
     all.p->write_cache = false;
     all.p->output->close_file();
@@ -250,7 +332,7 @@ void reset_source(vw& all, size_t numbits)
           io_buf::close_file_or_socket(fd);
       }
     input->open_file(all.p->output->finalname.begin(), all.stdin_off, io_buf::READ); //pushing is merged into open_file
-    all.p->reader = read_cached_features;
+    all.p->reader = all.p->blocks->write_blocks ? read_cached_blocks : read_cached_features;
   }
   if ( all.p->resettable == true )
   {
@@ -348,8 +430,11 @@ void make_write_cache(vw& all, string &newname, bool quiet)
 
   output->write_file(f, &v_length, sizeof(v_length));
   output->write_file(f,version.to_string().c_str(),v_length);
-  output->write_file(f,"c",1);
+  char type = all.p->blocks->write_blocks ? cache_blocks : cache_stream;
+  output->write_file(f, &type, 1);
   output->write_file(f, &all.num_bits, sizeof(all.num_bits));
+  if (all.p->blocks->write_blocks)
+    start_block_cache(all, sizeof(v_length) + v_length + 1 + sizeof(all.num_bits));
 
   push_many(output->finalname,newname.c_str(),newname.length()+1);
   all.p->write_cache = true;
@@ -381,7 +466,10 @@ void parse_cache(vw& all, po::variables_map &vm, string source,
       make_write_cache(all, caches[i], quiet);
     else
     {
-      uint64_t c = cache_numbits(all.p->input, f);
+      bool blocks = false;
+      uint64_t c = cache_numbits(all.p->input, f, &blocks);
+      if (blocks && all.p->input->compressed())
+        c = 0; // block caches are read by seeking, which gzip input can't do
       if (c < all.num_bits)
       {
         if (!quiet)
@@ -393,7 +481,7 @@ void parse_cache(vw& all, po::variables_map &vm, string source,
       {
         if (!quiet)
           all.opts_n_args.trace_message << "using cache_file = " << caches[i].c_str() << endl;
-        all.p->reader = read_cached_features;
+        all.p->reader = blocks ? read_cached_blocks : read_cached_features;
         if (c == all.num_bits)
           all.p->sorted_cache = true;
         else
@@ -516,6 +604,9 @@ void enable_sources(vw& all, bool quiet, size_t passes)
       free(all.sd);
       all.sd = sd;
 
+      if (all.opts_n_args.vm.count("hot_swap"))
+        init_hot_swap(all, all.num_children);
+
       // create children
       size_t num_children = all.num_children;
       v_array<int> children = v_init<int>();
@@ -527,6 +618,7 @@ void enable_sources(vw& all, bool quiet, size_t passes)
         if ((children[i] = fork()) == 0)
         {
           all.quiet |= (i > 0);
+          join_hot_swap(all, i);
           goto child;
         }
       }
@@ -539,10 +631,28 @@ void enable_sources(vw& all, bool quiet, size_t passes)
         memset(&sa, 0, sizeof(sa));
         sa.sa_handler = handle_sigterm;
         sigaction(SIGTERM, &sa, nullptr);
+        if (all.swap != nullptr)
+        {
+          sa.sa_handler = handle_sighup;
+          sigaction(SIGHUP, &sa, nullptr);
+        }
       }
 
       while (true)
       {
+        if (got_sighup)
+        {
+          got_sighup = false;
+          reload_model(all, children.begin());
+          // respawn the children that died while it waited for them
+          for (size_t i = 0; i < num_children; i++)
+            if (children[i] == 0 && (children[i] = fork()) == 0)
+            {
+              all.quiet |= (i > 0);
+              join_hot_swap(all, i);
+              goto child;
+            }
+        }
         // wait for child to change state; if finished, then respawn
         int status;
         pid_t pid = wait(&status);
@@ -561,6 +671,7 @@ void enable_sources(vw& all, bool quiet, size_t passes)
             if ((children[i]=fork()) == 0)
             {
               all.quiet |= (i > 0);
+              join_hot_swap(all, i);
               goto child;
             }
             break;
@@ -676,6 +787,8 @@ void lock_done(parser& p)
 {
   mutex_lock(&p.examples_lock);
   p.done = true;
+  if (p.handoff != nullptr)
+    p.handoff->done.store(true, std::memory_order_release);
   //in case get_example() is waiting for a fresh example, wake so it can realize there are no more.
   condition_variable_signal_all(&p.example_available);
   mutex_unlock(&p.examples_lock);
@@ -733,17 +846,17 @@ void addgrams(vw& all, size_t ngram, size_t skip_gram, features& fs,
  * Hash is evaluated using the principle h(a, b) = h(a)*X + h(b), where X is a random no.
  * 32 random nos. are maintained in an array and are used in the hashing.
  */
-void generateGrams(vw& all, example* &ex)
+void generateGrams(vw& all, example* &ex, v_array<size_t>& gram_mask)
 {
   for(namespace_index index : ex->indices)
   {
     size_t length = ex->feature_space[index].size();
     for (size_t n = 1; n < all.ngram[index]; n++)
     {
-      all.p->gram_mask.clear();
-      all.p->gram_mask.push_back((size_t)0);
+      gram_mask.clear();
+      gram_mask.push_back((size_t)0);
       addgrams(all, n, all.skips[index], ex->feature_space[index],
-               length, all.p->gram_mask, 0);
+               length, gram_mask, 0);
     }
   }
 }
@@ -771,6 +884,17 @@ namespace VW
 example& get_unused_example(vw* all)
 {
   parser* p = all->p;
+  if (p->handoff != nullptr)
+  {
+    std::atomic<bool>& unused = p->handoff->unused[p->begin_parsed_examples % p->ring_size];
+    wait_for(*p, p->handoff->parked_parsers, &p->example_unused,
+             [&unused] { return unused.load(std::memory_order_acquire); });
+    unused.store(false, std::memory_order_relaxed);
+    example& ret = p->examples[p->begin_parsed_examples++ % p->ring_size];
+    ret.in_use = true;
+    return ret;
+  }
+
   while (true)
   {
     mutex_lock(&p->examples_lock);
@@ -799,14 +923,16 @@ void setup_example(vw& all, example* ae)
     unique_sort_features(all.parse_mask, ae);
 
   if (all.p->write_cache)
-  {
-    all.p->lp.cache_label(&ae->l, *(all.p->output));
-    cache_features(*(all.p->output), ae, all.parse_mask);
-  }
+    cache_example(all, ae);
+
+  setup_example_counters(all, ae, example_is_newline(*ae) != 0);
+  setup_example_features(all, ae, all.p->gram_mask);
+}
+}
 
+void setup_example_counters(vw& all, example* ae, bool is_newline)
+{
   ae->partial_prediction = 0.;
-  ae->num_features = 0;
-  ae->total_sum_feat_sq = 0;
   ae->loss = 0.;
 
   ae->example_counter = (size_t)(all.p->end_parsed_examples);
@@ -816,11 +942,14 @@ void setup_example(vw& all, example* ae)
   ae->test_only = is_test_only(all.p->in_pass_counter, all.holdout_period, all.holdout_after, all.holdout_set_off, all.p->emptylines_separate_examples ? (all.holdout_period-1) : 0);
   ae->test_only |= all.p->lp.test_label(&ae->l);
 
-  if (all.p->emptylines_separate_examples && example_is_newline(*ae))
+  if (all.p->emptylines_separate_examples && is_newline)
     all.p->in_pass_counter++;
 
   ae->weight = all.p->lp.get_weight(&ae->l);
+}
 
+void setup_example_features(vw& all, example* ae, v_array<size_t>& gram_mask)
+{
   if (all.ignore_some)
     for (unsigned char* i = ae->indices.begin(); i != ae->indices.end(); i++)
       if (all.ignore[*i])
@@ -833,7 +962,7 @@ void setup_example(vw& all, example* ae)
       }
 
   if(all.ngram_strings.size() > 0)
-    generateGrams(all, ae);
+    generateGrams(all, ae, gram_mask);
 
   if (all.add_constant)//add constant feature
     VW::add_constant_feature(all,ae);
@@ -847,6 +976,8 @@ void setup_example(vw& all, example* ae)
     for (features& fs : *ae)
       for (auto& j : fs.indicies)
         j *= multiplier;
+  for (features& fs : *ae)
+    fs.find_dense(multiplier, dense_min_features);
   ae->num_features = 0;
   ae->total_sum_feat_sq = 0;
   for (features& fs : *ae)
@@ -861,7 +992,6 @@ void setup_example(vw& all, example* ae)
   ae->num_features += new_features_cnt;
   ae->total_sum_feat_sq += new_features_sum_feat_sq;
 }
-}
 
 namespace VW
 {
@@ -879,7 +1009,7 @@ example* read_example(vw& all, char* example_line)
 
   VW::read_line(all, ret, example_line);
   setup_example(all, ret);
-  all.p->end_parsed_examples++;
+  all.p->ready[all.p->end_parsed_examples++ % all.p->ring_size] = ret;
 
   return ret;
 }
@@ -919,7 +1049,7 @@ example* import_example(vw& all, string label, primitive_feature_space* features
   }
 
   setup_example(all, ret);
-  all.p->end_parsed_examples++;
+  all.p->ready[all.p->end_parsed_examples++ % all.p->ring_size] = ret;
   return ret;
 }
 
@@ -993,6 +1123,28 @@ void finish_example(vw& all, example& ec)
   if (!is_ring_example(all, &ec))
     return;
 
+  parser* p = all.p;
+  if (p->handoff != nullptr)
+  {
+    // only the daemon waits on output_done
+    if (all.daemon)
+      mutex_lock(&p->output_lock);
+    p->local_example_number++;
+    if (all.daemon)
+    {
+      condition_variable_signal(&p->output_done);
+      mutex_unlock(&p->output_lock);
+    }
+
+    empty_example(all, ec);
+
+    assert(ec.in_use);
+    ec.in_use = false;
+    p->handoff->unused[&ec - p->examples].store(true, std::memory_order_release);
+    wake_parked(*p, p->handoff->parked_parsers, &p->example_unused);
+    return;
+  }
+
   mutex_lock(&all.p->output_lock);
   all.p->local_example_number++;
   condition_variable_signal(&all.p->output_done);
@@ -1010,12 +1162,39 @@ void finish_example(vw& all, example& ec)
 }
 }
 
+void publish_examples(vw& all, example** examples, size_t count)
+{
+  parser* p = all.p;
+  if (p->handoff != nullptr)
+  {
+    for (size_t i = 0; i < count; i++)
+      p->ready[p->end_parsed_examples++ % p->ring_size] = examples[i];
+    p->handoff->published.store(p->end_parsed_examples, std::memory_order_release);
+    wake_parked(*p, p->handoff->parked_learners, &p->example_available);
+    return;
+  }
+
+  mutex_lock(&p->examples_lock);
+  for (size_t i = 0; i < count; i++)
+    p->ready[p->end_parsed_examples++ % p->ring_size] = examples[i];
+  condition_variable_signal_all(&p->example_available);
+  mutex_unlock(&p->examples_lock);
+}
+
+bool next_example_unused(parser& p)
+{
+  if (p.handoff != nullptr)
+    return p.handoff->unused[p.begin_parsed_examples % p.ring_size].load(std::memory_order_acquire);
+
+  mutex_lock(&p.examples_lock);
+  bool ret = !p.examples[p.begin_parsed_examples % p.ring_size].in_use;
+  mutex_unlock(&p.examples_lock);
+  return ret;
+}
+
 void thread_dispatch(vw& all, v_array<example*> examples)
 {
-  mutex_lock(&all.p->examples_lock);
-  all.p->end_parsed_examples+=examples.size();
-  condition_variable_signal_all(&all.p->example_available);
-  mutex_unlock(&all.p->examples_lock);
+  publish_examples(all, examples.begin(), examples.size());
 }
 
 #ifdef _WIN32
@@ -1033,15 +1212,30 @@ namespace VW
 {
 example* get_example(parser* p)
 {
+  if (p->handoff != nullptr)
+  {
+    ring_handoff& h = *p->handoff;
+    wait_for(*p, h.parked_learners, &p->example_available, [&h, p]
+    {
+      return h.published.load(std::memory_order_acquire) != p->used_index || h.done.load(std::memory_order_acquire);
+    });
+    if (h.published.load(std::memory_order_acquire) == p->used_index)
+      return nullptr;
+    example* ret = p->ready[p->used_index++ % p->ring_size];
+    assert(ret->in_use);
+    return ret;
+  }
+
   mutex_lock(&p->examples_lock);
   if (p->end_parsed_examples != p->used_index)
   {
     size_t ring_index = p->used_index++ % p->ring_size;
-    if (!(p->examples+ring_index)->in_use)
+    example* ret = p->ready[ring_index];
+    if (!ret->in_use)
       cout << "error: example should be in_use " << p->used_index << " " << p->end_parsed_examples << " " << ring_index << endl;
-    assert((p->examples+ring_index)->in_use);
+    assert(ret->in_use);
     mutex_unlock(&p->examples_lock);
-    return p->examples + ring_index;
+    return ret;
   }
   else
   {
@@ -1059,6 +1253,27 @@ example* get_example(parser* p)
   }
 }
 
+size_t get_examples(parser* p, example** ecs, size_t max)
+{
+  if ((ecs[0] = get_example(p)) == nullptr)
+    return 0;
+
+  size_t count = 1;
+  if (p->handoff != nullptr)
+  {
+    uint64_t published = p->handoff->published.load(std::memory_order_acquire);
+    while (count < max && p->used_index != published)
+      ecs[count++] = p->ready[p->used_index++ % p->ring_size];
+    return count;
+  }
+
+  mutex_lock(&p->examples_lock);
+  while (count < max && p->end_parsed_examples != p->used_index)
+    ecs[count++] = p->ready[p->used_index++ % p->ring_size];
+  mutex_unlock(&p->examples_lock);
+  return count;
+}
+
 float get_topic_prediction(example* ec, size_t i)
 { return ec->pred.scalars[i]; }
 
@@ -1132,12 +1347,27 @@ void initialize_examples(vw& all)
   all.p->done = false;
 
   all.p->examples = calloc_or_throw<example>(all.p->ring_size);
+  all.p->ready = calloc_or_throw<example*>(all.p->ring_size);
 
   for (size_t i = 0; i < all.p->ring_size; i++)
   {
     memset(&all.p->examples[i].l, 0, sizeof(polylabel));
     all.p->examples[i].in_use = false;
   }
+
+  if (all.p->lockfree_ring)
+  {
+    ring_handoff* h = new ring_handoff();
+    h->published = 0;
+    h->unused = new std::atomic<bool>[all.p->ring_size];
+    for (size_t i = 0; i < all.p->ring_size; i++)
+      h->unused[i] = true;
+    h->done = false;
+    h->parked_parsers = 0;
+    h->parked_learners = 0;
+    h->spins = std::thread::hardware_concurrency() > 1 ? 1 << 12 : 0;
+    all.p->handoff = h;
+  }
 }
 
 void adjust_used_index(vw& all)
@@ -1159,6 +1389,7 @@ namespace VW
 {
 void start_parser(vw& all)
 {
+  start_parse_pool(all);
 #ifndef _WIN32
   pthread_create(&all.parse_thread, nullptr, main_parse_loop, &all);
 #else
@@ -1181,6 +1412,14 @@ void free_parser(vw& all)
       VW::dealloc_example(all.p->lp.delete_label, all.p->examples[i], all.delete_prediction);
 
     free(all.p->examples);
+    free(all.p->ready);
+  }
+
+  if (all.p->handoff != nullptr)
+  {
+    delete[] all.p->handoff->unused;
+    delete all.p->handoff;
+    all.p->handoff = nullptr;
   }
 
   io_buf* output = all.p->output;
@@ -1191,6 +1430,12 @@ void free_parser(vw& all)
   }
 
   all.p->counts.delete_v();
+
+  delete all.p->blocks;
+  all.p->blocks = nullptr;
+
+  delete all.p->hashes;
+  all.p->hashes = nullptr;
 }
 
 void release_parser_datastructures(vw& all)
@@ -1209,6 +1454,7 @@ void end_parser(vw& all)
   ::WaitForSingleObject(all.parse_thread, INFINITE);
   ::CloseHandle(all.parse_thread);
 #endif
+  end_parse_pool(all);
   release_parser_datastructures(all);
 }
 
@@ -12,6 +12,10 @@ license as described in the file LICENSE.
 namespace po = boost::program_options;
 
 struct vw;
+struct parse_pool;
+struct ring_handoff;
+struct block_cache;
+struct hash_cache;
 
 struct parser
 { v_array<substring> channels;//helper(s) for text parsing
@@ -26,6 +30,7 @@ struct parser
   bool write_cache;
   bool sort_features;
   bool sorted_cache;
+  block_cache* blocks; // reading and writing --block_cache files
 
   size_t ring_size;
   uint64_t begin_parsed_examples; // The index of the beginning parsed example.
@@ -33,6 +38,7 @@ struct parser
   uint64_t local_example_number;
   uint32_t in_pass_counter;
   example* examples;
+  example** ready; // ring of published examples in the order the learner receives them
   uint64_t used_index;
   bool emptylines_separate_examples; // true if you want to have holdout computed on a per-block basis rather than a per-line basis
   MUTEX examples_lock;
@@ -40,10 +46,18 @@ struct parser
   CV example_unused;
   MUTEX output_lock;
   CV output_done;
+  bool lockfree_ring; // hand examples over through atomics instead of examples_lock, see ring_handoff
+  ring_handoff* handoff;
 
   bool done;
   v_array<size_t> gram_mask;
 
+  size_t parse_threads; // number of text parsing workers, 0 for a single parse thread
+  bool parse_unordered; // workers publish examples as they finish rather than in input order
+  parse_pool* pool;
+  size_t hash_cache_size; // --hash_cache entries per parse thread, 0 for none
+  hash_cache* hashes; // the cache of the parse thread; totals the lookups of all of them at the end
+
   v_array<size_t> ids; //unique ids for sources
   v_array<size_t> counts; //partial examples received from sources
   size_t finished_count;//the number of finished examples;
@@ -73,6 +87,8 @@ void adjust_used_index(vw& all);
 
 //parser control
 void make_example_available();
+void publish_examples(vw& all, example** examples, size_t count);
+bool next_example_unused(parser& p);
 void lock_done(parser& p);
 void set_done(vw& all);
 
@@ -81,5 +97,10 @@ bool inconsistent_cache(size_t numbits, io_buf& cache);
 void reset_source(vw& all, size_t numbits);
 void finalize_source(parser* source);
 void set_compressed(parser* par);
+void set_mapped(parser* par);
 void initialize_examples(vw& all);
+
+//the halves of VW::setup_example that parse workers split between them
+void setup_example_counters(vw& all, example* ae, bool is_newline);
+void setup_example_features(vw& all, example* ae, v_array<size_t>& gram_mask);
 void free_parser(vw& all);
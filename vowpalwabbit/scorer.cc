@@ -21,6 +21,33 @@ void predict_or_learn(scorer& s, LEARNER::single_learner& base, example& ec)
   ec.pred.scalar = link(ec.pred.scalar);
 }
 
+// set_minmax changes nothing for labels within the range already seen, so a
+// batch of those can go to the base learner in one call.
+inline bool in_range(shared_data* sd, float label)
+{ return label == FLT_MAX || (label >= sd->min_label && label <= sd->max_label); }
+
+template <float (*link)(float in)>
+void predict_batch(scorer& s, LEARNER::single_learner& base, example** ecs, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+    if (!in_range(s.all->sd, ecs[i]->l.simple.label))
+    { // one example at a time, as predict_or_learn would see them
+      for (size_t j = 0; j < count; j++)
+        predict_or_learn<false, link>(s, base, *ecs[j]);
+      return;
+    }
+
+  base.predict_batch(ecs, count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    example& ec = *ecs[i];
+    if(ec.weight > 0 && ec.l.simple.label != FLT_MAX)
+      ec.loss = s.all->loss->getLoss(s.all->sd, ec.pred.scalar, ec.l.simple.label) * ec.weight;
+    ec.pred.scalar = link(ec.pred.scalar);
+  }
+}
+
 template <float (*link)(float in)>
 inline void multipredict(scorer&, LEARNER::single_learner& base, example& ec, size_t count, size_t, polyprediction*pred, bool finalize_predictions)
 {
@@ -61,22 +88,28 @@ LEARNER::base_learner* scorer_setup(arguments& arg)
   void (*multipredict_f)(scorer&, LEARNER::single_learner&, example&, size_t, size_t, polyprediction*, bool) = multipredict<id>;
 
   if ( link.compare("identity") == 0)
+  {
     l = &init_learner(s, base, predict_or_learn<true, id>, predict_or_learn<false, id>);
+    l->set_predict_batch(predict_batch<id>);
+  }
   else if (link.compare("logistic") == 0)
   {
     l = &init_learner(s, base, predict_or_learn<true, logistic>,
                       predict_or_learn<false, logistic>);
+    l->set_predict_batch(predict_batch<logistic>);
     multipredict_f = multipredict<logistic>;
   }
   else if (link.compare("glf1") == 0)
   {
     l = &init_learner(s, base, predict_or_learn<true, glf1>,
                       predict_or_learn<false, glf1>);
+    l->set_predict_batch(predict_batch<glf1>);
     multipredict_f = multipredict<glf1>;
   }
   else if (link.compare("poisson") == 0)
   {
     l = &init_learner(s, base, predict_or_learn<true, expf>, predict_or_learn<false, expf>);
+    l->set_predict_batch(predict_batch<expf>);
     multipredict_f = multipredict<expf>;
   }
   else
@@ -293,7 +293,12 @@ void sort_data_update_support(stagewise_poly &poly)
     uint64_t wid = stride_shift(poly, i);
     if (!parent_get(poly, wid) && wid != constant_feat_masked(poly))
     {
-      float weightsal = (fabsf(poly.all->weights[wid]) * poly.all->weights[poly.all->normalized_idx + (wid)]);
+      // one lookup at a time: with --sparse_weights a new index can move the others
+      float weightsal = fabsf(poly.all->weights[wid]);
+      if (poly.all->half_state)
+        weightsal *= GD::half_normalized(&poly.all->weights[wid]);
+      else
+        weightsal *= poly.all->weights[poly.all->normalized_idx + (wid)];
       /*
        * here's some depth penalization code.  It was found to not improve
        * statistical performance, and meanwhile it is verified as giving
@@ -76,6 +76,8 @@ void setup_examples(vw& all, v_array<example*>& examples);
 void setup_example(vw& all, example* ae);
 example* new_unused_example(vw& all);
 example* get_example(parser* pf);
+//waits for one example like get_example, then also takes any already parsed, up to max in all; returns how many
+size_t get_examples(parser* pf, example** ecs, size_t max);
 float get_topic_prediction(example*ec, size_t i);//i=0 to max topic -1
 float get_label(example*ec);
 float get_importance(example*ec);
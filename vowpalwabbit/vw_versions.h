@@ -16,3 +16,4 @@ license as described in the file LICENSE.
 #define VERSION_FILE_WITH_HEADER_CHAINED_HASH "8.0.2" // first version with header's chained hash used for more reliably validating model content
 #define VERSION_FILE_WITH_HEADER_ID "8.0.3" // first version with user supplied header
 #define VERSION_FILE_WITH_CB_ADF_SAVE "8.3.2" // first version with user supplied header
+#define VERSION_FILE_WITH_WEIGHT_CHUNKS "8.6.2" // first version that saves dense weights in chunks coded in parallel
@@ -0,0 +1,191 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include "weight_pages.h"
+#include "memory.h"
+
+using namespace std;
+
+#ifdef _WIN32
+// large pages need the lock pages in memory privilege on windows, so the weights stay in ordinary pages there
+void* alloc_weight_pages(size_t bytes, const weight_pages&, size_t& mapped_length)
+{
+  mapped_length = 0;
+  return calloc_or_throw<char>(bytes);
+}
+
+void free_weight_pages(void* data, size_t) { free(data); }
+
+void* map_weight_file(int, uint64_t, size_t, size_t&) { return nullptr; }
+
+string describe_weight_pages(void*, size_t) { return "not reported on windows"; }
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+const size_t transparent_huge_page = 2 << 20;
+
+size_t round_up(size_t n, size_t multiple) { return (n + multiple - 1) / multiple * multiple; }
+
+// the value of a "Name: <n> kB" line in /proc/meminfo or smaps, or 0
+size_t kb_field(const string& line, const char* name)
+{
+  size_t length = strlen(name);
+  if (line.compare(0, length, name) != 0 || line.size() <= length || line[length] != ':')
+    return 0;
+  return strtoull(line.c_str() + length + 1, nullptr, 10);
+}
+
+// the default hugetlbfs page size, or 0 when the kernel has none
+size_t hugetlb_page_size()
+{
+  ifstream meminfo("/proc/meminfo");
+  for (string line; getline(meminfo, line);)
+    if (size_t kb = kb_field(line, "Hugepagesize"))
+      return kb << 10;
+  return 0;
+}
+
+#ifdef __linux__
+// the online NUMA nodes as a bitmask, from a list like "0-3,6"
+unsigned long online_nodes()
+{
+  ifstream online("/sys/devices/system/node/online");
+  unsigned long nodes = 0;
+  for (string range; getline(online, range, ',');)
+  {
+    unsigned first, last;
+    int n = sscanf(range.c_str(), "%u-%u", &first, &last);
+    if (n < 1)
+      continue;
+    if (n == 1)
+      last = first;
+    for (unsigned node = first; node <= last && node < 8 * sizeof(nodes); node++)
+      nodes |= 1UL << node;
+  }
+  return nodes;
+}
+#endif
+
+void* map_or_throw(size_t length, int flags)
+{
+  void* data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+  if (data == MAP_FAILED)
+  {
+    const char* msg = "internal error: memory allocation failed!\n";
+    fputs(msg, stderr);
+    THROW(msg);
+  }
+  return data;
+}
+}
+
+void* alloc_weight_pages(size_t bytes, const weight_pages& pages, size_t& mapped_length)
+{
+  void* data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  size_t hugetlb_page = pages.huge ? hugetlb_page_size() : 0;
+  if (hugetlb_page > 0)
+  { // fails unless enough huge pages are reserved, e.g. with vm.nr_hugepages
+    mapped_length = round_up(bytes, hugetlb_page);
+    data = mmap(nullptr, mapped_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (data == MAP_FAILED)
+  { // map a page of slack so that the weights can start on a huge page boundary
+    size_t alignment = pages.huge ? transparent_huge_page : (size_t)sysconf(_SC_PAGE_SIZE);
+    mapped_length = round_up(bytes, alignment);
+    char* slack = (char*)map_or_throw(mapped_length + alignment, 0);
+    char* start = (char*)round_up((uintptr_t)slack, alignment);
+    if (start > slack)
+      munmap(slack, start - slack);
+    if (slack + alignment > start)
+      munmap(start + mapped_length, slack + alignment - start);
+    data = start;
+#ifdef MADV_HUGEPAGE
+    if (pages.huge && madvise(data, mapped_length, MADV_HUGEPAGE) != 0)
+      cerr << "warning: transparent huge pages are not available for the weights" << endl;
+#endif
+  }
+#ifdef __linux__
+  if (pages.interleave)
+  { // before the first touch, so every page is placed by the policy
+    const int mpol_interleave = 3;
+    unsigned long nodes = online_nodes();
+    if (syscall(SYS_mbind, data, mapped_length, mpol_interleave, &nodes, 8 * sizeof(nodes) + 1, 0) != 0)
+      cerr << "warning: interleaving the weights over NUMA nodes failed" << endl;
+  }
+#endif
+  return data;
+}
+
+void free_weight_pages(void* data, size_t mapped_length)
+{
+  if (mapped_length > 0)
+    munmap(data, mapped_length);
+  else
+    free(data);
+}
+
+void* map_weight_file(int fd, uint64_t offset, size_t bytes, size_t& mapped_length)
+{
+  struct stat st;
+  if (bytes == 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uint64_t)st.st_size < offset + bytes)
+    return nullptr;
+  void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t)offset);
+  if (data == MAP_FAILED)
+    return nullptr;
+  mapped_length = bytes;
+  return data;
+}
+
+string describe_weight_pages(void* data, size_t mapped_length)
+{
+  ifstream smaps("/proc/self/smaps");
+  if (!smaps)
+    return "not reported";
+
+  // the kernel may have split the mapping, so add up every area inside it
+  uintptr_t begin = (uintptr_t)data, end = begin + mapped_length;
+  bool inside = false;
+  size_t resident = 0, transparent = 0, hugetlb = 0, page = 0;
+  for (string line; getline(smaps, line);)
+  {
+    unsigned long long first, last;
+    if (sscanf(line.c_str(), "%llx-%llx ", &first, &last) == 2)
+    {
+      inside = first >= begin && first < end;
+      continue;
+    }
+    if (!inside)
+      continue;
+    resident += kb_field(line, "Rss");
+    transparent += kb_field(line, "AnonHugePages");
+    hugetlb += kb_field(line, "Private_Hugetlb") + kb_field(line, "Shared_Hugetlb");
+    if (size_t kb = kb_field(line, "KernelPageSize"))
+      page = kb;
+  }
+
+  stringstream description;
+  description << fixed << setprecision(1);
+  if (hugetlb > 0 || page > (size_t)sysconf(_SC_PAGE_SIZE) >> 10)
+    description << hugetlb / 1024. << " MB in " << page << " kB hugetlb pages";
+  else
+    description << resident / 1024. << " MB resident, " << transparent / 1024. << " MB in transparent huge pages";
+  return description.str();
+}
+#endif
@@ -0,0 +1,34 @@
+/*
+Copyright (c) by respective owners including Yahoo!, Microsoft, and
+individual contributors. All rights reserved.  Released under a BSD
+license as described in the file LICENSE.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/* How the dense weight array is backed.  By default it is an ordinary zeroed
+   allocation.  Random lookups into a table of several GB miss the dTLB on
+   almost every feature, so --huge_pages maps it from hugetlbfs when the
+   kernel has huge pages reserved, and otherwise asks for transparent huge
+   pages with MADV_HUGEPAGE.  --numa_interleave spreads the pages round robin
+   over the NUMA nodes, so that threads on every node see the same latency. */
+struct weight_pages
+{
+  bool huge;
+  bool interleave;
+
+  weight_pages() : huge(false), interleave(false) {}
+
+  bool mapped() const { return huge || interleave; }
+};
+
+//zeroed memory for bytes of weights, mapped as pages asks.  mapped_length is set to what free_weight_pages must unmap.
+void* alloc_weight_pages(size_t bytes, const weight_pages& pages, size_t& mapped_length);
+void free_weight_pages(void* data, size_t mapped_length);
+//bytes of regular file fd from offset, a multiple of the page size, mapped copy on write: pages stay in the page cache shared
+//with every process mapping the file until one writes to them.  nullptr when the file can't be mapped.
+void* map_weight_file(int fd, uint64_t offset, size_t bytes, size_t& mapped_length);
+//the page sizes backing the resident part of an allocation, e.g. "1024 MB resident, 1022 MB in 2048 kB pages"
+std::string describe_weight_pages(void* data, size_t mapped_length);